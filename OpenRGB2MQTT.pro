@@ -10,6 +10,10 @@ TARGET = OpenRGB2MQTT
 DEFINES += GIT_COMMIT_ID=\\\"plugin-build\\\"
 DEFINES += GIT_COMMIT_DATE=\\\"plugin-date\\\"
 
+# In-memory trace level (0 = off, 1 = error, 2 = info, 3 = debug)
+# Trace points above this level compile to nothing
+DEFINES += OPENRGB2MQTT_TRACE_LEVEL=2
+
 # Output directories
 DESTDIR = $$PWD/build/output
 OBJECTS_DIR = $$PWD/build/intermediate/obj
@@ -63,8 +67,22 @@ DEPENDPATH += mqtt_qt_setup/include OpenRGB/RGBController
 # Source files
 HEADERS += \
     src/utils/EncryptionHelper.h \
+    src/utils/Trace.h \
+    src/utils/PayloadHash.h \
+    src/utils/LatencyHistogram.h \
+    src/utils/StageMetrics.h \
     src/plugin/OpenRGB2MQTT.h \
     src/mqtt/MQTTHandler.h \
+    src/mqtt/MQTTConnection.h \
+    src/mqtt/TopicAliasTable.h \
+    src/mqtt/SubscriptionRegistry.h \
+    src/mqtt/TopicTable.h \
+    src/mqtt/BridgeMetrics.h \
+    src/mqtt/MessageRingBuffer.h \
+    src/mqtt/TopicTrie.h \
+    src/mqtt/OutboundQueue.h \
+    src/mqtt/PublishOptions.h \
+    src/mqtt/PublishRateLimiter.h \
     src/devices/DeviceManager.h \
     src/config/ConfigManager.h \
     src/devices/base/MQTTRGBDevice.h \
@@ -72,20 +90,34 @@ HEADERS += \
     src/devices/base/RGBControllerTypes.h \
     src/devices/mosquitto/MosquittoDeviceManager.h \
     src/devices/mosquitto/MosquittoLightDevice.h \
+    src/devices/mosquitto/DiscoveryCache.h \
     OpenRGB/RGBController/RGBController.h \
     OpenRGB/RGBController/RGBControllerKeyNames.h \
     OpenRGB/LogManager.h
 
 SOURCES += \
     src/utils/EncryptionHelper.cpp \
+    src/utils/Trace.cpp \
+    src/utils/LatencyHistogram.cpp \
+    src/utils/StageMetrics.cpp \
     src/plugin/OpenRGB2MQTT.cpp \
     src/mqtt/MQTTHandler.cpp \
+    src/mqtt/MQTTConnection.cpp \
+    src/mqtt/TopicAliasTable.cpp \
+    src/mqtt/SubscriptionRegistry.cpp \
+    src/mqtt/TopicTable.cpp \
+    src/mqtt/BridgeMetrics.cpp \
+    src/mqtt/MessageRingBuffer.cpp \
+    src/mqtt/TopicTrie.cpp \
+    src/mqtt/OutboundQueue.cpp \
+    src/mqtt/PublishRateLimiter.cpp \
     src/devices/DeviceManager.cpp \
     src/config/ConfigManager.cpp \
     src/devices/base/MQTTRGBDevice.cpp \
     src/devices/base/CustomRGBController.cpp \
     src/devices/mosquitto/MosquittoDeviceManager.cpp \
     src/devices/mosquitto/MosquittoLightDevice.cpp \
+    src/devices/mosquitto/DiscoveryCache.cpp \
     OpenRGB/RGBController/RGBController.cpp \
     OpenRGB/RGBController/RGBControllerKeyNames.cpp \
     OpenRGB/LogManager.cpp
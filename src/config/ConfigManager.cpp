@@ -8,6 +8,38 @@
 #include <QFileInfo>
 #include "utils/EncryptionHelper.h"
 
+static QJsonObject rateLimit(double rate, double burst)
+{
+    QJsonObject limit;
+    limit["rate"] = rate;
+    limit["burst"] = burst;
+    return limit;
+}
+
+static QJsonArray defaultMetricsSections()
+{
+    // "stages" is left out by default - it is the largest section
+    return QJsonArray({"rates", "queues", "frames", "connection", "latency", "devices"});
+}
+
+static QJsonObject defaultRateLimits()
+{
+    // Keep Zigbee meshes responsive during effects; 0 means unlimited
+    QJsonObject protocols;
+    protocols["mosquitto"] = rateLimit(0, 0);
+    protocols["zigbee"] = rateLimit(100, 20);
+
+    QJsonObject device_classes;
+    device_classes["MosquittoLightDevice"] = rateLimit(30, 5);
+    device_classes["ZigbeeLightDevice"] = rateLimit(10, 3);
+
+    QJsonObject limits;
+    limits["global"] = rateLimit(500, 100);
+    limits["protocols"] = protocols;
+    limits["device_classes"] = device_classes;
+    return limits;
+}
+
 ConfigManager::ConfigManager(QObject* parent) :
     QObject(parent)
 {
@@ -98,6 +130,32 @@ void ConfigManager::createDefaultConfig()
     config["client_id"] = "openrgb2mqtt";
     config["base_topic"] = "homeassistant/openrgb";
     config["autoconnect"] = false;
+    config["protocol_version"] = "5";
+    config["topic_alias_maximum"] = 16;
+    config["persistent_session"] = true;
+    config["session_expiry_s"] = 3600;
+    config["final_state_qos"] = 1;
+    config["max_in_flight"] = 16;
+    config["connection_pool_size"] = 1;
+    config["reconnect_min_ms"] = 1000;
+    config["reconnect_max_ms"] = 60000;
+
+    // Inbound queue settings
+    config["inbound_queue_max_bytes"] = 16 * 1024 * 1024;
+    config["inbound_overflow_policy"] = "drop_newest";
+    config["inbound_drain_budget_us"] = 2000;
+
+    // Outbound publish settings
+    config["publish_flush_interval_ms"] = 16;
+    config["streaming_expiry_s"] = 1;
+    config["offline_buffer_max_bytes"] = 1024 * 1024;
+    config["backpressure_high_bytes"] = 256 * 1024;
+    config["backpressure_low_bytes"] = 64 * 1024;
+    config["rate_limits"] = defaultRateLimits();
+
+    // Bridge self-metrics published to <base_topic>/bridge/metrics
+    config["metrics_interval_s"] = 30;
+    config["metrics_sections"] = defaultMetricsSections();
 }
 
 QString ConfigManager::getConfigPath() const
@@ -228,6 +286,114 @@ void ConfigManager::setAutoConnect(bool enabled)
     emit mqttConfigChanged();
 }
 
+QString ConfigManager::getProtocolVersion() const
+{
+    return config["protocol_version"].toString("5");
+}
+
+int ConfigManager::getTopicAliasMaximum() const
+{
+    return qBound(0, config["topic_alias_maximum"].toInt(16), 65535);
+}
+
+bool ConfigManager::getPersistentSession() const
+{
+    return config["persistent_session"].toBool(true);
+}
+
+int ConfigManager::getSessionExpirySec() const
+{
+    return qMax(0, config["session_expiry_s"].toInt(3600));
+}
+
+int ConfigManager::getFinalStateQos() const
+{
+    return qBound(0, config["final_state_qos"].toInt(1), 2);
+}
+
+int ConfigManager::getMaxInFlight() const
+{
+    return qMax(1, config["max_in_flight"].toInt(16));
+}
+
+int ConfigManager::getConnectionPoolSize() const
+{
+    return qBound(1, config["connection_pool_size"].toInt(1), 8);
+}
+
+int ConfigManager::getReconnectMinMs() const
+{
+    return config["reconnect_min_ms"].toInt(1000);
+}
+
+int ConfigManager::getReconnectMaxMs() const
+{
+    return config["reconnect_max_ms"].toInt(60000);
+}
+
+qint64 ConfigManager::getInboundQueueMaxBytes() const
+{
+    return static_cast<qint64>(config["inbound_queue_max_bytes"].toDouble(16 * 1024 * 1024));
+}
+
+QString ConfigManager::getInboundOverflowPolicy() const
+{
+    return config["inbound_overflow_policy"].toString("drop_newest");
+}
+
+int ConfigManager::getInboundDrainBudgetUsec() const
+{
+    return config["inbound_drain_budget_us"].toInt(2000);
+}
+
+int ConfigManager::getPublishFlushIntervalMs() const
+{
+    return config["publish_flush_interval_ms"].toInt(16);
+}
+
+int ConfigManager::getStreamingExpirySec() const
+{
+    return config["streaming_expiry_s"].toInt(1);
+}
+
+qint64 ConfigManager::getOfflineBufferMaxBytes() const
+{
+    return static_cast<qint64>(config["offline_buffer_max_bytes"].toDouble(1024 * 1024));
+}
+
+qint64 ConfigManager::getBackpressureHighBytes() const
+{
+    return static_cast<qint64>(config["backpressure_high_bytes"].toDouble(256 * 1024));
+}
+
+qint64 ConfigManager::getBackpressureLowBytes() const
+{
+    return static_cast<qint64>(config["backpressure_low_bytes"].toDouble(64 * 1024));
+}
+
+QJsonObject ConfigManager::getRateLimits() const
+{
+    if (config.contains("rate_limits") && config["rate_limits"].isObject()) {
+        return config["rate_limits"].toObject();
+    }
+    return defaultRateLimits();
+}
+
+int ConfigManager::getMetricsIntervalSec() const
+{
+    return config["metrics_interval_s"].toInt(30);
+}
+
+QStringList ConfigManager::getMetricsSections() const
+{
+    QJsonArray sections = config["metrics_sections"].isArray() ? config["metrics_sections"].toArray()
+                                                               : defaultMetricsSections();
+    QStringList result;
+    for (const QJsonValue& section : sections) {
+        result.append(section.toString());
+    }
+    return result;
+}
 
 bool ConfigManager::isDeviceEnabled(const std::string& device_name) const
 {
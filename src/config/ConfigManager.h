@@ -5,6 +5,7 @@
 #include <QString>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QStringList>
 
 class ConfigManager : public QObject
 {
@@ -42,6 +43,42 @@ public:
 
     bool getAutoConnect() const;
     void setAutoConnect(bool enabled);
+
+    // Protocol settings - "5" or "3.1.1"
+    QString getProtocolVersion() const;
+    int getTopicAliasMaximum() const;
+
+    // Session and delivery guarantees
+    bool getPersistentSession() const;
+    int getSessionExpirySec() const;
+    int getFinalStateQos() const;
+    int getMaxInFlight() const;
+
+    // Number of broker connections publishes are spread across
+    int getConnectionPoolSize() const;
+
+    // Reconnect backoff bounds
+    int getReconnectMinMs() const;
+    int getReconnectMaxMs() const;
+
+    // Inbound message queue settings
+    qint64 getInboundQueueMaxBytes() const;
+    QString getInboundOverflowPolicy() const;
+    int getInboundDrainBudgetUsec() const;
+
+    // Outbound publish settings
+    int getPublishFlushIntervalMs() const;
+    int getStreamingExpirySec() const;
+    qint64 getOfflineBufferMaxBytes() const;
+    qint64 getBackpressureHighBytes() const;
+    qint64 getBackpressureLowBytes() const;
+
+    // Bridge self-metrics - interval 0 disables, sections pick what is published
+    int getMetricsIntervalSec() const;
+    QStringList getMetricsSections() const;
+
+    // Publish rate limits - {"global": {...}, "protocols": {...}, "device_classes": {...}}
+    QJsonObject getRateLimits() const;
     
  
     // Device settings
@@ -1,10 +1,14 @@
 #include "DeviceManager.h"
 #include "mosquitto/MosquittoDeviceManager.h"
+#include "base/MQTTRGBDevice.h"
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QJsonDocument>
 #include "OpenRGB/LogManager.h"
+#include "utils/Trace.h"
+#include "utils/StageMetrics.h"
 #include <QFile>
+#include <QFileInfo>
 #include <QCoreApplication>
 
 DeviceManager::DeviceManager(ResourceManagerInterface* resource_manager, QObject* parent)
@@ -24,10 +28,15 @@ DeviceManager::DeviceManager(ResourceManagerInterface* resource_manager, QObject
         // Initialize mosquitto manager
         mosquitto_manager = new MosquittoDeviceManager(this);
         if (mosquitto_manager) {
-            connect(mosquitto_manager, SIGNAL(mqttPublishNeeded(QString,QByteArray)),
-                    this, SIGNAL(mqttPublishNeeded(QString,QByteArray)));
+            connect(mosquitto_manager, SIGNAL(mqttPublishNeeded(QString,QByteArray,PublishOptions)),
+                    this, SIGNAL(mqttPublishNeeded(QString,QByteArray,PublishOptions)));
             connect(mosquitto_manager, SIGNAL(deviceListChanged()),
                     this, SLOT(onProtocolDevicesChanged()));
+            connect(mosquitto_manager, SIGNAL(subscriptionNeeded(QString)),
+                    this, SIGNAL(subscriptionNeeded(QString)));
+            connect(mosquitto_manager, SIGNAL(unsubscriptionNeeded(QString)),
+                    this, SIGNAL(unsubscriptionNeeded(QString)));
+            mosquitto_manager->registerRoutes(topic_router);
         }
     } catch (const std::exception& e) {
         LOG_WARNING("[DeviceManager] Error initializing MosquittoDeviceManager: %s", e.what());
@@ -52,6 +61,9 @@ DeviceManager::~DeviceManager()
         update_timer = nullptr;
     }
     
+    // Drop routes before the managers they point into go away
+    topic_router.clear();
+
     // Delete device managers
     if (mosquitto_manager) {
         delete mosquitto_manager;
@@ -67,7 +79,12 @@ DeviceManager::~DeviceManager()
 void DeviceManager::setMQTTHandler(QObject* handler)
 {
     mqtt_handler = handler;
-    // MQTT handler has been set
+
+    // Effect frames stop at the devices while the transport is backed up
+    if (mqtt_handler) {
+        connect(mqtt_handler, SIGNAL(backpressureChanged(bool)),
+                this, SLOT(onBackpressureChanged(bool)));
+    }
 }
 
 void DeviceManager::setConfigManager(ConfigManager* manager)
@@ -117,6 +134,12 @@ void DeviceManager::setConfigManager(ConfigManager* manager)
             }
             file.close();
         }
+
+        // Discovery cache lives next to the config file
+        if (mosquitto_manager) {
+            QString cache_dir = QFileInfo(config_manager->config_file).absolutePath();
+            mosquitto_manager->setDiscoveryCacheFile(cache_dir + "/openrgb2mqtt_discovery_cache.json");
+        }
         
         // Get all available devices and check their saved state as a backup
         auto all_devices = getAllAvailableDevices();
@@ -214,17 +237,13 @@ void DeviceManager::discoverAllDevices()
     }
 }
 
-void DeviceManager::handleMQTTMessage(const QString& topic, const QByteArray& payload)
+void DeviceManager::handleMQTTMessage(TopicId topic_id, const QString& topic, const QByteArray& payload)
 {
-    // Route messages to appropriate protocol manager
-    if (topic.startsWith("homeassistant/")) {
-        LOG_DEBUG("Routing homeassistant message: %s", qUtf8Printable(topic));
-        if (mosquitto_manager) {
-            mosquitto_manager->handleMQTTMessage(topic, payload);
-        } else {
-            LOG_WARNING("Received homeassistant MQTT message but no mosquitto manager available");
-        }
-    }
+    StageMetrics::ScopedTimer timer(StageMetrics::Dispatch);
+
+    // Route messages to the protocol managers that registered a matching filter
+    [[maybe_unused]] const bool routed = topic_router.dispatch(topic_id, topic, payload);
+    TRACE_DEBUG("devices", routed ? "dispatch" : "unrouted", payload.size(), 0);
 }
 
 void DeviceManager::discoverDevices()
@@ -232,6 +251,29 @@ void DeviceManager::discoverDevices()
     discoverAllDevices();
 }
 
+void DeviceManager::resyncDeviceStates()
+{
+    // Resend the current state of every device in OpenRGB, the broker may have missed changes
+    std::vector<MQTTRGBDevice*> devices;
+    {
+        QMutexLocker locker(&device_mutex);
+        for (auto device : cached_devices) {
+            auto added = devices_added_to_openrgb.find(device->name);
+            if (added == devices_added_to_openrgb.end() || !added->second) {
+                continue;
+            }
+            if (MQTTRGBDevice* mqtt_device = dynamic_cast<MQTTRGBDevice*>(device)) {
+                devices.push_back(mqtt_device);
+            }
+        }
+    }
+
+    LOG_INFO("[DeviceManager] Resyncing state for %d devices", static_cast<int>(devices.size()));
+    for (auto device : devices) {
+        device->PublishState();
+    }
+}
+
 std::vector<RGBController*> DeviceManager::getDevices() const
 {
     QMutexLocker locker(&device_mutex);
@@ -251,6 +293,15 @@ void DeviceManager::onMQTTConnectionChanged(bool connected)
     }
 }
 
+void DeviceManager::onBackpressureChanged(bool active)
+{
+    // Mosquitto is the only protocol manager created here. ZigbeeDeviceManager has its own
+    // setStreamingPaused for when it is wired in alongside it.
+    if (mosquitto_manager) {
+        mosquitto_manager->setStreamingPaused(active);
+    }
+}
+
 void DeviceManager::onProtocolDevicesChanged()
 {
     update_timer->start(100); // Debounce device updates
@@ -3,6 +3,8 @@
 #include "../../OpenRGB/RGBController/RGBController.h"
 #include "../../OpenRGB/ResourceManagerInterface.h"
 #include "../config/ConfigManager.h"
+#include "../mqtt/TopicTrie.h"
+#include "../mqtt/PublishOptions.h"
 #include <QObject>
 #include <QTimer>
 #include <QMutex>
@@ -25,7 +27,7 @@ public:
     | Discovery and message handling                          |
     \*------------------------------------------------------*/
     void discoverAllDevices();
-    virtual void handleMQTTMessage(const QString& topic, const QByteArray& payload);
+    virtual void handleMQTTMessage(TopicId topic_id, const QString& topic, const QByteArray& payload);
     virtual void discoverDevices();
     virtual std::vector<RGBController*> getDevices() const;
 
@@ -59,12 +61,15 @@ signals:
     \*------------------------------------------------------*/
     void deviceListChanged();
     void deviceColorChanged(const std::string& device_name, const RGBColor& color);
-    void mqttPublishNeeded(const QString& topic, const QByteArray& payload);
+    void mqttPublishNeeded(const QString& topic, const QByteArray& payload, const PublishOptions& options = PublishOptions());
     void subscriptionNeeded(const QString& topic);
+    void unsubscriptionNeeded(const QString& topic);
 
 public slots:
     void onProtocolDevicesChanged();
     void onMQTTConnectionChanged(bool connected);
+    void onBackpressureChanged(bool active);
+    void resyncDeviceStates();
 
 public:
     void updateDeviceList();
@@ -74,6 +79,7 @@ private:
     void subscribeToTopics();
 
     MosquittoDeviceManager* mosquitto_manager;
+    TopicTrie topic_router;     // Inbound topic filter -> protocol manager handler
     QTimer* update_timer;
     mutable QMutex device_mutex;
     std::vector<RGBController*> cached_devices;
@@ -3,6 +3,10 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include "OpenRGB/LogManager.h"
+#include "utils/Trace.h"
+#include "utils/PayloadHash.h"
+#include "utils/LatencyHistogram.h"
+#include "utils/StageMetrics.h"
 #include <algorithm>
 
 MQTTRGBDevice::MQTTRGBDevice(const LightInfo& info)
@@ -20,6 +24,18 @@ MQTTRGBDevice::MQTTRGBDevice(const LightInfo& info)
     serial      = info.unique_id.toStdString();
     location    = "MQTT";
 
+    // Subclasses name their protocol with setProtocol, which also picks the latency histogram
+    publish_options.device_class = "MQTTRGBDevice";
+    publish_options.protocol     = "mqtt";
+
+    // Validated once here so color frames reuse the topic instead of rebuilding it
+    publish_options.topic_name   = QMqttTopicName(mqtt_topic);
+    if (!publish_options.topic_name.isValid()) {
+        LOG_WARNING("[MQTTRGBDevice] Invalid command topic for %s: %s",
+                    qUtf8Printable(info.name), qUtf8Printable(mqtt_topic));
+        publish_options.topic_name = QMqttTopicName();
+    }
+
     // Set up modes
     modes.resize(1 + (info.has_effects ? info.effect_list.size() : 0));
 
@@ -81,6 +97,34 @@ void MQTTRGBDevice::SetupZones()
 }
 
 void MQTTRGBDevice::DeviceUpdateLEDs()
+{
+    if (skipWhilePaused())
+        return;
+    publishColors(PublishOptions::Streaming);
+}
+
+bool MQTTRGBDevice::skipWhilePaused()
+{
+    // Effect frames from OpenRGB - a newer frame makes this one stale
+    if (streaming_paused.load(std::memory_order_relaxed)) {
+        frame_skipped.store(true, std::memory_order_relaxed);
+        TRACE_DEBUG("device", "frame_skipped", 0, 0);
+        return true;
+    }
+    return false;
+}
+
+void MQTTRGBDevice::SetStreamingPaused(bool paused)
+{
+    streaming_paused.store(paused, std::memory_order_relaxed);
+
+    // Catch up with the frame the effect is currently showing
+    if (!paused && frame_skipped.exchange(false, std::memory_order_relaxed)) {
+        DeviceUpdateLEDs();
+    }
+}
+
+void MQTTRGBDevice::publishColors(PublishOptions::Delivery delivery)
 {
     if (!send_updates)
         return;
@@ -96,13 +140,28 @@ void MQTTRGBDevice::DeviceUpdateLEDs()
         // We'll just send the format without the template syntax
         QString payload = QString::asprintf("#%02x%02x%02x0000", r, g, b);
         
-        LOG_DEBUG("Sending color values - R: %d G: %d B: %d", r, g, b);
-        LOG_DEBUG("Sending MQTT payload: %s to topic: %s", qUtf8Printable(payload), qUtf8Printable(mqtt_topic));
-        emit mqttPublishNeeded(mqtt_topic, payload.toUtf8());
+        TRACE_DEBUG("device", "update_leds", colors[0], payload.size());
+        emit mqttPublishNeeded(mqtt_topic, payload.toUtf8(), frameOptions(delivery));
     }
     // Multiple LED support would go here if needed
 }
 
+void MQTTRGBDevice::setProtocol(const QString& protocol)
+{
+    // Looked up once here - frames are built on effect threads and only read publish_options
+    publish_options.protocol = protocol;
+    publish_options.latency  = Latency::forProtocol(protocol);
+}
+
+PublishOptions MQTTRGBDevice::frameOptions(PublishOptions::Delivery delivery) const
+{
+    PublishOptions options = publish_options.withDelivery(delivery);
+    options.lane = delivery == PublishOptions::Streaming ? PublishOptions::StreamingLane
+                                                         : PublishOptions::ControlLane;
+    options.origin_ns = Latency::nowNs();
+    return options;
+}
+
 void MQTTRGBDevice::UpdateZoneLEDs(int /*zone*/)
 {
     DeviceUpdateLEDs();
@@ -139,7 +198,41 @@ void MQTTRGBDevice::ResizeZone(int /*zone*/, int /*new_size*/)
 
 void MQTTRGBDevice::PublishState()
 {
-    DeviceUpdateLEDs();
+    publishColors(PublishOptions::Final);
+}
+
+bool MQTTRGBDevice::ApplyMQTTState(const QByteArray& payload)
+{
+    // zigbee2mqtt republishes the full state for every attribute change, linkquality included
+    const quint64 hash = PayloadHash::fnv1a(payload);
+    if (hash == last_state_hash) {
+        TRACE_DEBUG("device", "state_duplicate", hash, 0);
+        return false;
+    }
+    last_state_hash = hash;
+
+    const std::vector<RGBColor> old_colors = colors;
+    const int old_mode = active_mode;
+    std::vector<unsigned int> old_brightness;
+    old_brightness.reserve(modes.size());
+    for (const mode& m : modes) {
+        old_brightness.push_back(m.brightness);
+    }
+
+    {
+        StageMetrics::ScopedTimer timer(StageMetrics::DeviceUpdate);
+        UpdateFromMQTT(payload);
+    }
+
+    if (colors != old_colors || active_mode != old_mode || modes.size() != old_brightness.size()) {
+        return true;
+    }
+    for (size_t i = 0; i < modes.size(); i++) {
+        if (modes[i].brightness != old_brightness[i]) {
+            return true;
+        }
+    }
+    return false;
 }
 
 void MQTTRGBDevice::UpdateFromMQTT(const QByteArray& payload)
@@ -5,6 +5,8 @@
 #include <QObject>
 #include <QStringList>
 #include <QByteArray>
+#include <atomic>
+#include "../../mqtt/PublishOptions.h"
 
 class MQTTRGBDevice : public QObject, public RGBController
 {
@@ -40,20 +42,39 @@ public:
 
     // MQTT specific functions
     virtual void UpdateFromMQTT(const QByteArray& payload);
+    // Runs UpdateFromMQTT unless the payload repeats the previous one byte for byte.
+    // Returns true only when colors, the active mode or a mode brightness changed.
+    bool        ApplyMQTTState(const QByteArray& payload);
     QString     GetTopic() const { return mqtt_topic; }
     virtual void PublishState();
+    // Set while the MQTT transport is backpressured. Effect frames are skipped until it
+    // clears, then the latest colors go out once if any frame was skipped.
+    void        SetStreamingPaused(bool paused);
 
 signals:
     // Signal for MQTT message publishing
-    void mqttPublishNeeded(const QString& topic, const QByteArray& payload);
+    void mqttPublishNeeded(const QString& topic, const QByteArray& payload, const PublishOptions& options = PublishOptions());
 
 protected:
+    // True while streaming is paused; marks the frame as skipped for the catch-up on resume
+    bool skipWhilePaused();
+    // Sets publish_options.protocol and the latency histogram frames are recorded into.
+    // Subclasses call it from their constructor.
+    void setProtocol(const QString& protocol);
+    // Copy of publish_options for one frame, stamped for the protocol's latency histogram
+    PublishOptions frameOptions(PublishOptions::Delivery delivery) const;
+
     QString mqtt_topic;
+    PublishOptions publish_options;     // Identifies this device to the outbound rate limiter
     QString rgb_command_template;
     QString rgb_value_template;
     QByteArray last_state;
+    quint64 last_state_hash = 0;        // PayloadHash of the last state applied, 0 before the first
     bool send_updates;
     int color_mode;
+    std::atomic<bool> streaming_paused{false};  // Written on the GUI thread, read from effect threads
+    std::atomic<bool> frame_skipped{false};
 
 private:
+    void publishColors(PublishOptions::Delivery delivery);
 };
\ No newline at end of file
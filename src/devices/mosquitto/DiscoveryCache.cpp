@@ -0,0 +1,128 @@
+#include "DiscoveryCache.h"
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include "OpenRGB/LogManager.h"
+#include "utils/PayloadHash.h"
+
+namespace
+{
+    const int CACHE_VERSION = 1;
+}
+
+quint64 DiscoveryCache::hashPayload(const QByteArray& payload)
+{
+    return PayloadHash::fnv1a(payload);
+}
+
+bool DiscoveryCache::lookup(const QString& topic, quint64 hash, MQTTRGBDevice::LightInfo& info) const
+{
+    auto it = entries.constFind(topic);
+    if (it == entries.constEnd() || it.value().hash != hash) {
+        return false;
+    }
+    info = it.value().info;
+    return true;
+}
+
+void DiscoveryCache::store(const QString& topic, quint64 hash, const MQTTRGBDevice::LightInfo& info)
+{
+    entries.insert(topic, {hash, info});
+    dirty = true;
+}
+
+void DiscoveryCache::remove(const QString& topic)
+{
+    if (entries.remove(topic) > 0) {
+        dirty = true;
+    }
+}
+
+bool DiscoveryCache::load(const QString& filename)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    file.close();
+
+    QJsonObject root = doc.object();
+    if (root.value("version").toInt() != CACHE_VERSION) {
+        LOG_INFO("[DiscoveryCache] Ignoring cache with unknown version in %s", qUtf8Printable(filename));
+        return false;
+    }
+
+    entries.clear();
+    QJsonObject topics = root.value("topics").toObject();
+    for (auto it = topics.constBegin(); it != topics.constEnd(); ++it) {
+        QJsonObject obj = it.value().toObject();
+
+        bool ok = false;
+        quint64 hash = obj.value("hash").toString().toULongLong(&ok, 16);
+        if (!ok) {
+            continue;
+        }
+
+        MQTTRGBDevice::LightInfo info;
+        info.name = obj.value("name").toString();
+        info.unique_id = obj.value("unique_id").toString();
+        info.state_topic = obj.value("state_topic").toString();
+        info.command_topic = obj.value("command_topic").toString();
+        info.rgb_command_template = obj.value("rgb_command_template").toString();
+        info.rgb_value_template = obj.value("rgb_value_template").toString();
+        info.num_leds = obj.value("num_leds").toInt(1);
+        info.has_brightness = obj.value("has_brightness").toBool();
+        info.has_rgb = obj.value("has_rgb").toBool(true);
+        info.has_effects = obj.value("has_effects").toBool();
+        for (const QJsonValue& effect : obj.value("effect_list").toArray()) {
+            info.effect_list.append(effect.toString());
+        }
+
+        entries.insert(it.key(), {hash, info});
+    }
+
+    dirty = false;
+    LOG_INFO("[DiscoveryCache] Loaded %d cached discovery configs", entries.size());
+    return true;
+}
+
+bool DiscoveryCache::save(const QString& filename)
+{
+    QJsonObject topics;
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        const MQTTRGBDevice::LightInfo& info = it.value().info;
+
+        QJsonObject obj;
+        obj["hash"] = QString::number(it.value().hash, 16);
+        obj["name"] = info.name;
+        obj["unique_id"] = info.unique_id;
+        obj["state_topic"] = info.state_topic;
+        obj["command_topic"] = info.command_topic;
+        obj["rgb_command_template"] = info.rgb_command_template;
+        obj["rgb_value_template"] = info.rgb_value_template;
+        obj["num_leds"] = info.num_leds;
+        obj["has_brightness"] = info.has_brightness;
+        obj["has_rgb"] = info.has_rgb;
+        obj["has_effects"] = info.has_effects;
+        obj["effect_list"] = QJsonArray::fromStringList(info.effect_list);
+        topics[it.key()] = obj;
+    }
+
+    QJsonObject root;
+    root["version"] = CACHE_VERSION;
+    root["topics"] = topics;
+
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        LOG_WARNING("[DiscoveryCache] Could not write %s", qUtf8Printable(filename));
+        return false;
+    }
+
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    file.close();
+    dirty = false;
+    return true;
+}
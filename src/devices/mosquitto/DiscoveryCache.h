@@ -0,0 +1,44 @@
+#pragma once
+
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include "../base/MQTTRGBDevice.h"
+
+/*---------------------------------------------------------*\
+| DiscoveryCache                                            |
+|                                                           |
+| Remembers the last discovery config seen on each topic as |
+| a hash of the raw payload plus the LightInfo parsed from  |
+| it. The broker replays every retained config on connect;  |
+| a payload whose hash matches is answered from here with   |
+| no JSON parsing. Saved to disk so a restart starts warm.  |
+\*---------------------------------------------------------*/
+
+class DiscoveryCache
+{
+public:
+    // Stable across runs, so hashes can be persisted
+    static quint64 hashPayload(const QByteArray& payload);
+
+    // True when topic was last seen with this hash; info is filled from the cached parse.
+    // An entry with an empty command_topic is a config that was rejected before.
+    bool lookup(const QString& topic, quint64 hash, MQTTRGBDevice::LightInfo& info) const;
+    void store(const QString& topic, quint64 hash, const MQTTRGBDevice::LightInfo& info);
+    void remove(const QString& topic);
+
+    int size() const { return entries.size(); }
+    bool isDirty() const { return dirty; }
+
+    bool load(const QString& filename);
+    bool save(const QString& filename);
+
+private:
+    struct Entry {
+        quint64 hash;
+        MQTTRGBDevice::LightInfo info;
+    };
+
+    QHash<QString, Entry> entries;
+    bool dirty = false;
+};
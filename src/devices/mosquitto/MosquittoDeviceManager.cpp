@@ -2,15 +2,33 @@
 #include "MosquittoLightDevice.h"
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QThread>
+#include <algorithm>
 #include "OpenRGB/LogManager.h"
 
 MosquittoDeviceManager::MosquittoDeviceManager(QObject* parent)
     : QObject(parent)
+    , cache_save_timer(new QTimer(this))
+    , burst_timer(new QTimer(this))
 {
+    cache_save_timer->setSingleShot(true);
+    cache_save_timer->setInterval(2000);
+    connect(cache_save_timer, &QTimer::timeout, this, &MosquittoDeviceManager::saveDiscoveryCache);
+
+    burst_timer->setSingleShot(true);
+    burst_timer->setInterval(50);
+    connect(burst_timer, &QTimer::timeout, this, &MosquittoDeviceManager::mergeBurst);
+
+    // Leave a core for the GUI and the network thread
+    parse_pool.setMaxThreadCount(qBound(1, QThread::idealThreadCount() - 1, 4));
 }
 
 MosquittoDeviceManager::~MosquittoDeviceManager()
 {
+    // Jobs post their results back to us - none may still be running once we are gone
+    parse_pool.waitForDone();
+    saveDiscoveryCache();
+
     for(auto device : devices) {
         delete device;
     }
@@ -19,19 +37,43 @@ MosquittoDeviceManager::~MosquittoDeviceManager()
 
 void MosquittoDeviceManager::discoverDevices()
 {
-    // Subscribe to Home Assistant light discovery topics
-    emit mqttPublishNeeded("homeassistant/light/#", "");
-    emit mqttPublishNeeded("homeassistant/+/light/+/config", "");
+    // The broker replays retained discovery configs once we are subscribed
+    subscribeToTopics();
 }
 
-void MosquittoDeviceManager::handleMQTTMessage(const QString& topic, const QByteArray& payload)
+void MosquittoDeviceManager::setDiscoveryCacheFile(const QString& filename)
 {
-    // Handle Home Assistant discovery messages
-    if (topic.startsWith("homeassistant/light") && topic.endsWith("/config")) {
-        processDeviceConfig(topic, payload);
+    discovery_cache_file = filename;
+    discovery_cache.load(filename);
+}
+
+void MosquittoDeviceManager::scheduleCacheSave()
+{
+    if (!discovery_cache_file.isEmpty() && !cache_save_timer->isActive()) {
+        cache_save_timer->start();
+    }
+}
+
+void MosquittoDeviceManager::saveDiscoveryCache()
+{
+    cache_save_timer->stop();
+    if (!discovery_cache_file.isEmpty() && discovery_cache.isDirty()) {
+        discovery_cache.save(discovery_cache_file);
     }
 }
 
+void MosquittoDeviceManager::registerRoutes(TopicTrie& router)
+{
+    this->router = &router;
+
+    // Home Assistant discovery: <prefix>/light/[<node_id>/]<object_id>/config
+    auto config_handler = [this](const QString& topic, const QByteArray& payload) {
+        processDeviceConfig(topic, payload);
+    };
+    router.insert("homeassistant/light/+/config", config_handler);
+    router.insert("homeassistant/light/+/+/config", config_handler);
+}
+
 std::vector<RGBController*> MosquittoDeviceManager::getDevices() const
 {
     std::vector<RGBController*> result;
@@ -42,11 +84,129 @@ std::vector<RGBController*> MosquittoDeviceManager::getDevices() const
     return result;
 }
 
+void MosquittoDeviceManager::setStreamingPaused(bool paused)
+{
+    streaming_paused = paused;
+    for (MosquittoLightDevice* device : devices) {
+        device->SetStreamingPaused(paused);
+    }
+}
+
 void MosquittoDeviceManager::processDeviceConfig(const QString& topic, const QByteArray& payload)
+{
+    DiscoveredConfig config;
+    config.sequence = burst_sequence++;
+    config.topic = topic;
+    config.hash = 0;
+    config.removed = false;
+    config.cached = false;
+    config.valid = false;
+    config.info = MQTTRGBDevice::LightInfo();
+
+    // An empty retained payload removes the config
+    if (payload.isEmpty()) {
+        config.removed = true;
+        addToBurst(std::move(config));
+        return;
+    }
+
+    // Retained configs are replayed on every connect - only parse the ones that changed
+    config.hash = DiscoveryCache::hashPayload(payload);
+    if (discovery_cache.lookup(topic, config.hash, config.info)) {
+        config.cached = true;
+        config.valid = !config.info.command_topic.isEmpty();
+        addToBurst(std::move(config));
+        return;
+    }
+
+    // Parsed off the GUI thread; the result comes back queued to mergeBurst's thread
+    burst_outstanding++;
+    parse_pool.start([this, config, payload]() mutable {
+        config.valid = parseDeviceConfig(payload, config.info);
+        QMetaObject::invokeMethod(this, [this, config = std::move(config)]() mutable {
+            burst_outstanding--;
+            addToBurst(std::move(config));
+        }, Qt::QueuedConnection);
+    });
+}
+
+void MosquittoDeviceManager::addToBurst(DiscoveredConfig&& config)
+{
+    burst.push_back(std::move(config));
+    if (burst_outstanding == 0) {
+        burst_timer->start();
+    }
+}
+
+void MosquittoDeviceManager::mergeBurst()
+{
+    // The last parse job to come back restarts the timer
+    if (burst_outstanding > 0) {
+        return;
+    }
+
+    std::vector<DiscoveredConfig> configs;
+    configs.swap(burst);
+    std::sort(configs.begin(), configs.end(), [](const DiscoveredConfig& a, const DiscoveredConfig& b) {
+        return a.sequence < b.sequence;
+    });
+
+    bool cache_changed = false;
+    int added = 0;
+    for (DiscoveredConfig& config : configs) {
+        if (config.removed) {
+            discovery_cache.remove(config.topic);
+            cache_changed = true;
+            continue;
+        }
+
+        if (!config.cached) {
+            // Rejected configs are cached too so their replays are skipped
+            discovery_cache.store(config.topic, config.hash,
+                                  config.valid ? config.info : MQTTRGBDevice::LightInfo());
+            cache_changed = true;
+        }
+
+        if (!config.valid)
+            continue;
+
+        QString deviceTopic = config.topic.left(config.topic.lastIndexOf("/"));
+        if (!devices.contains(deviceTopic)) {
+            MosquittoLightDevice* device = new MosquittoLightDevice(config.info);
+            device->SetStreamingPaused(streaming_paused);
+            connect(device, &MosquittoLightDevice::mqttPublishNeeded,
+                    this, &MosquittoDeviceManager::mqttPublishNeeded);
+            devices[deviceTopic] = device;
+
+            // Route this device's state topic straight to it
+            const QString& state_topic = config.info.state_topic;
+            if (router && !state_topic.isEmpty()
+                && !state_topic.contains('+') && !state_topic.contains('#')) {
+                router->insert(state_topic, [this, device](const QString&, const QByteArray& payload) {
+                    processDeviceState(device, payload);
+                });
+                emit subscriptionNeeded(state_topic);
+            }
+            added++;
+        }
+    }
+
+    if (cache_changed) {
+        scheduleCacheSave();
+    }
+
+    // One list rebuild for the whole burst
+    if (added > 0) {
+        LOG_INFO("[MosquittoDeviceManager] Discovered %d devices from %d configs", added, static_cast<int>(configs.size()));
+        emit deviceListChanged();
+    }
+}
+
+bool MosquittoDeviceManager::parseDeviceConfig(const QByteArray& payload, MQTTRGBDevice::LightInfo& info)
 {
     QJsonDocument doc = QJsonDocument::fromJson(payload);
     if (!doc.isObject())
-        return;
+        return false;
 
     // Process device config
 
@@ -59,7 +219,6 @@ void MosquittoDeviceManager::processDeviceConfig(const QString& topic, const QBy
     }
 
     // Extract device information
-    MQTTRGBDevice::LightInfo info;
     QJsonObject deviceObj = config.value("dev").toObject();
     info.name = deviceObj.value("name").toString();
     if (info.name.isEmpty()) {
@@ -95,33 +254,31 @@ void MosquittoDeviceManager::processDeviceConfig(const QString& topic, const QBy
     info.rgb_value_template = config.value("rgb_val_tpl").toString();
     
     if (info.name.isEmpty() || info.command_topic.isEmpty())
-        return;
+        return false;
 
     info.has_brightness = !config.value("bri_cmd_t").toString().isEmpty();
     info.has_rgb = true;
     info.num_leds = 1;
-
-    QString deviceTopic = topic.left(topic.lastIndexOf("/"));
-    auto it = devices.find(deviceTopic);
-    if (it == devices.end()) {
-        MosquittoLightDevice* device = new MosquittoLightDevice(info);
-        connect(device, &MosquittoLightDevice::mqttPublishNeeded,
-                this, &MosquittoDeviceManager::mqttPublishNeeded);
-        devices[deviceTopic] = device;
-        emit deviceListChanged();
-    }
+    info.has_effects = false;
+    return true;
 }
 
-void MosquittoDeviceManager::processDeviceState(const QString& topic, const QByteArray& payload)
+void MosquittoDeviceManager::processDeviceState(MosquittoLightDevice* device, const QByteArray& payload)
 {
-    auto it = devices.find(topic);
-    if (it != devices.end()) {
-        it.value()->UpdateFromMQTT(payload);
+    if (device->ApplyMQTTState(payload)) {
         emit deviceListChanged();
     }
 }
 
 void MosquittoDeviceManager::subscribeToTopics()
 {
-    // No additional subscriptions needed - handled in discoverDevices()
+    // Held for the lifetime of the manager; the handler restores them after reconnects
+    if (topics_subscribed) {
+        return;
+    }
+    topics_subscribed = true;
+
+    // Same filters as the routes in registerRoutes
+    emit subscriptionNeeded("homeassistant/light/+/config");
+    emit subscriptionNeeded("homeassistant/light/+/+/config");
 }
\ No newline at end of file
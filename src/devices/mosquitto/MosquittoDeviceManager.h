@@ -2,8 +2,13 @@
 
 #include "../DeviceManager.h"
 #include "MosquittoLightDevice.h"
+#include "DiscoveryCache.h"
+#include "../../mqtt/TopicTrie.h"
 #include <QMap>
 #include <QString>
+#include <QTimer>
+#include <QThreadPool>
+#include <vector>
 
 class MosquittoDeviceManager : public QObject
 {
@@ -13,19 +18,58 @@ public:
     MosquittoDeviceManager(QObject* parent = nullptr);
     virtual ~MosquittoDeviceManager();
 
-    virtual void handleMQTTMessage(const QString& topic, const QByteArray& payload);
+    virtual void registerRoutes(TopicTrie& router);
     virtual void discoverDevices();
     virtual std::vector<RGBController*> getDevices() const;
 
+    // Loads the discovery cache from filename and saves it back there as it changes
+    void setDiscoveryCacheFile(const QString& filename);
+
+    // Forwarded to every device, including ones discovered while paused
+    void setStreamingPaused(bool paused);
+
 signals:
-    void mqttPublishNeeded(const QString& topic, const QByteArray& payload);
+    void mqttPublishNeeded(const QString& topic, const QByteArray& payload, const PublishOptions& options = PublishOptions());
     void deviceListChanged();
+    void subscriptionNeeded(const QString& filter);
+    void unsubscriptionNeeded(const QString& filter);
 
 protected:
     virtual void subscribeToTopics();
     void processDeviceConfig(const QString& topic, const QByteArray& payload);
-    void processDeviceState(const QString& topic, const QByteArray& payload);
+    void processDeviceState(MosquittoLightDevice* device, const QByteArray& payload);
+    static bool parseDeviceConfig(const QByteArray& payload, MQTTRGBDevice::LightInfo& info);
 
 private:
+    // One discovery config on its way from the router to the device map
+    struct DiscoveredConfig {
+        quint64 sequence;                   // Arrival order - parse jobs finish in any order
+        QString topic;
+        quint64 hash;
+        bool removed;                       // Empty retained payload
+        bool cached;                        // Answered by the discovery cache, nothing to store
+        bool valid;
+        MQTTRGBDevice::LightInfo info;
+    };
+
     QMap<QString, MosquittoLightDevice*> devices; // Map topic -> device
+    TopicTrie* router = nullptr;                  // Set by registerRoutes, per-device state routes go here
+    bool topics_subscribed = false;
+    bool streaming_paused = false;
+
+    DiscoveryCache discovery_cache;
+    QString discovery_cache_file;
+    QTimer* cache_save_timer;          // Coalesces the burst of configs replayed on connect into one write
+
+    // Discovery bursts - configs are parsed on the pool and merged here together
+    QThreadPool parse_pool;
+    std::vector<DiscoveredConfig> burst;
+    quint64 burst_sequence = 0;
+    int burst_outstanding = 0;          // Parse jobs not yet back
+    QTimer* burst_timer;                // Restarted by every config, fires once the burst goes quiet
+
+    void scheduleCacheSave();
+    void saveDiscoveryCache();
+    void addToBurst(DiscoveredConfig&& config);
+    void mergeBurst();
 };
\ No newline at end of file
@@ -6,6 +6,8 @@
 MosquittoLightDevice::MosquittoLightDevice(const LightInfo& info)
     : MQTTRGBDevice(info)
 {
+    publish_options.device_class = "MosquittoLightDevice";
+    setProtocol("mosquitto");
 }
 
 MosquittoLightDevice::~MosquittoLightDevice()
@@ -62,5 +64,5 @@ void MosquittoLightDevice::PublishState()
     state["color"] = color;
 
     QJsonDocument doc(state);
-    emit mqttPublishNeeded(mqtt_topic, doc.toJson(QJsonDocument::Compact));
+    emit mqttPublishNeeded(mqtt_topic, doc.toJson(QJsonDocument::Compact), publish_options);
 }
\ No newline at end of file
@@ -10,6 +10,9 @@
 ZigbeeDeviceManager::ZigbeeDeviceManager(QObject* parent)
     : QObject(parent)
 {
+    // The device list is one message per burst, a single worker is enough
+    parse_pool.setMaxThreadCount(1);
+
     // Send a test message as soon as the manager is created
     QTimer::singleShot(3000, this, [this]() {
         // Create a test message to turn the "Worm" light blue
@@ -32,6 +35,9 @@ ZigbeeDeviceManager::ZigbeeDeviceManager(QObject* parent)
 
 ZigbeeDeviceManager::~ZigbeeDeviceManager()
 {
+    // Jobs post their results back to us - none may still be running once we are gone
+    parse_pool.waitForDone();
+
     QMutexLocker locker(&device_mutex);
     for(auto device : devices) {
         delete device;
@@ -44,16 +50,14 @@ void ZigbeeDeviceManager::discoverDevices()
     LOG_INFO("[ZigbeeDeviceManager] Starting Zigbee device discovery");
     
     // Subscribe to bridge state and response topics
-    // Only emit if bridge state unknown
-    if (!bridge_state_known) {
-        emit mqttPublishNeeded("zigbee2mqtt/bridge/state", QByteArray());
-    }
+    subscribeToTopics();
     
     // Request device list
     QJsonObject request;
     request["topic"] = "bridge/devices";
     QJsonDocument doc(request);
-    emit mqttPublishNeeded("zigbee2mqtt/bridge/request/devices", doc.toJson(QJsonDocument::Compact));
+    emit mqttPublishNeeded("zigbee2mqtt/bridge/request/devices", doc.toJson(QJsonDocument::Compact),
+                           PublishOptions().withLane(PublishOptions::DiscoveryLane));
     
     // Send a simple test message to Worm device
     QTimer::singleShot(2000, this, [this]() {
@@ -63,7 +67,7 @@ void ZigbeeDeviceManager::discoverDevices()
     });
 }
 
-bool ZigbeeDeviceManager::isRGBLight(const QJsonObject& device) const
+bool ZigbeeDeviceManager::isRGBLight(const QJsonObject& device)
 {
     if (!device.contains("definition"))
         return false;
@@ -91,110 +95,154 @@ bool ZigbeeDeviceManager::isRGBLight(const QJsonObject& device) const
     return false;
 }
 
-void ZigbeeDeviceManager::handleMQTTMessage(const QString& topic, const QByteArray& payload)
+void ZigbeeDeviceManager::registerRoutes(TopicTrie& router)
+{
+    this->router = &router;
+
+    router.insert("zigbee2mqtt/bridge/state", [this](const QString&, const QByteArray& payload) {
+        handleBridgeState(payload);
+    });
+
+    auto device_list_handler = [this](const QString&, const QByteArray& payload) {
+        handleDeviceList(payload);
+    };
+    router.insert("zigbee2mqtt/bridge/devices", device_list_handler);
+    router.insert("zigbee2mqtt/bridge/response/devices", device_list_handler);
+}
+
+void ZigbeeDeviceManager::handleBridgeState(const QByteArray& payload)
 {
     QMutexLocker locker(&device_mutex);
+
+    QJsonDocument doc = QJsonDocument::fromJson(payload);
+    QString state = doc.object()["state"].toString();
     
-    // Handle bridge state
-    if (topic == "zigbee2mqtt/bridge/state") {
-        QJsonDocument doc = QJsonDocument::fromJson(payload);
-        QString state = doc.object()["state"].toString();
-        
-        if (state == "online" && !bridge_state_known) {
-            bridge_state_known = true;
-            // Request initial device list
-            QJsonObject request;
-            request["topic"] = "bridge/devices";
-            QJsonDocument doc(request);
-            emit mqttPublishNeeded("zigbee2mqtt/bridge/request/devices", doc.toJson(QJsonDocument::Compact));
-        }
-        return;
+    if (state == "online" && !bridge_state_known) {
+        bridge_state_known = true;
+        // Request initial device list
+        QJsonObject request;
+        request["topic"] = "bridge/devices";
+        QJsonDocument doc(request);
+        emit mqttPublishNeeded("zigbee2mqtt/bridge/request/devices", doc.toJson(QJsonDocument::Compact),
+                               PublishOptions().withLane(PublishOptions::DiscoveryLane));
     }
+}
 
-    // Handle device list response
-    if (topic == "zigbee2mqtt/bridge/devices" || topic == "zigbee2mqtt/bridge/response/devices") {
-        QJsonDocument doc = QJsonDocument::fromJson(payload);
-        if (!doc.isArray())
-            return;
-            
-        QJsonArray deviceList = doc.array();
-        // Process zigbee devices
+void ZigbeeDeviceManager::handleDeviceList(const QByteArray& payload)
+{
+    // bridge/devices lists the whole network - parse it on the pool, create devices back here
+    parse_pool.start([this, payload]() {
+        std::vector<MQTTRGBDevice::LightInfo> lights = parseDeviceList(payload);
+        QMetaObject::invokeMethod(this, [this, lights = std::move(lights)]() {
+            addDevices(lights);
+        }, Qt::QueuedConnection);
+    });
+}
+
+std::vector<MQTTRGBDevice::LightInfo> ZigbeeDeviceManager::parseDeviceList(const QByteArray& payload)
+{
+    std::vector<MQTTRGBDevice::LightInfo> lights;
+
+    QJsonDocument doc = QJsonDocument::fromJson(payload);
+    if (!doc.isArray())
+        return lights;
+        
+    QJsonArray deviceList = doc.array();
+    for (const QJsonValue& deviceVal : deviceList) {
+        QJsonObject device = deviceVal.toObject();
         
-        // Unsubscribe from all previous topics
-        QMapIterator<QString, ZigbeeLightDevice*> deviceIter(devices);
-        while (deviceIter.hasNext()) {
-            deviceIter.next();
-            emit mqttPublishNeeded(deviceIter.key(), QByteArray());  // Empty payload for unsubscribe
+        // Skip if not an RGB light
+        if (!isRGBLight(device)) {
+            continue;
         }
+            
+        QString friendly_name = device["friendly_name"].toString();
+        QString deviceTopic = "zigbee2mqtt/" + friendly_name;
+
+        MQTTRGBDevice::LightInfo info;
+        info.name = friendly_name;
+        info.unique_id = device["ieee_address"].toString();
+        info.state_topic = deviceTopic;
+        info.command_topic = deviceTopic + "/set";
+        info.num_leds = 1;
+        info.has_rgb = true;
+        info.has_brightness = true;
+        info.has_effects = false;
+        lights.push_back(info);
+    }
+    return lights;
+}
+
+void ZigbeeDeviceManager::addDevices(const std::vector<MQTTRGBDevice::LightInfo>& lights)
+{
+    QMutexLocker locker(&device_mutex);
+
+    int added = 0;
+    for (const MQTTRGBDevice::LightInfo& info : lights) {
+        const QString& friendly_name = info.name;
+        const QString& deviceTopic = info.state_topic;
         
-        for (const QJsonValue& deviceVal : deviceList) {
-            QJsonObject device = deviceVal.toObject();
+        // Create device if it doesn't exist
+        if (!devices.contains(deviceTopic)) {
+            LOG_INFO("Creating ZigbeeLightDevice: %s, topic: %s, command topic: %s", 
+                 qUtf8Printable(friendly_name), 
+                 qUtf8Printable(deviceTopic), 
+                 qUtf8Printable(deviceTopic + "/set"));
             
-            // Skip if not an RGB light
-            if (!isRGBLight(device)) {
-                continue;
-            }
-                
-            QString friendly_name = device["friendly_name"].toString();
-            QString deviceTopic = "zigbee2mqtt/" + friendly_name;
+            ZigbeeLightDevice* newDevice = new ZigbeeLightDevice(info);
+            newDevice->SetStreamingPaused(streaming_paused);
+            
+            // Connect both signals - use direct string-based SIGNAL/SLOT for more reliable connection
+            bool connection1 = connect(newDevice, SIGNAL(publishMessage(QString,QByteArray,PublishOptions)),
+                                    this, SIGNAL(mqttPublishNeeded(QString,QByteArray,PublishOptions)),
+                                    Qt::DirectConnection);
+                                    
+            bool connection2 = connect(newDevice, SIGNAL(mqttPublishNeeded(QString,QByteArray,PublishOptions)),
+                                    this, SIGNAL(mqttPublishNeeded(QString,QByteArray,PublishOptions)),
+                                    Qt::DirectConnection);
             
-            // Found zigbee RGB light - device creation handled in DeviceManager
+            LOG_INFO("Signal connections: publishMessage=%s, mqttPublishNeeded=%s",
+                     connection1 ? "SUCCESS" : "FAILED",
+                     connection2 ? "SUCCESS" : "FAILED");
             
-            // Create device if it doesn't exist
-            if (!devices.contains(deviceTopic)) {
-                MQTTRGBDevice::LightInfo info;
-                info.name = friendly_name;
-                info.unique_id = device["ieee_address"].toString();
-                info.state_topic = deviceTopic;
-                info.command_topic = deviceTopic + "/set";
-                info.num_leds = 1;
-                info.has_rgb = true;
-                info.has_brightness = true;
-                
-                LOG_INFO("Creating ZigbeeLightDevice: %s, topic: %s, command topic: %s", 
-                     qUtf8Printable(friendly_name), 
-                     qUtf8Printable(deviceTopic), 
-                     qUtf8Printable(deviceTopic + "/set"));
-                
-                ZigbeeLightDevice* newDevice = new ZigbeeLightDevice(info);
-                
-                // Connect both signals - use direct string-based SIGNAL/SLOT for more reliable connection
-                bool connection1 = connect(newDevice, SIGNAL(publishMessage(QString,QByteArray)),
-                                        this, SIGNAL(mqttPublishNeeded(QString,QByteArray)),
-                                        Qt::DirectConnection);
-                                        
-                bool connection2 = connect(newDevice, SIGNAL(mqttPublishNeeded(QString,QByteArray)),
-                                        this, SIGNAL(mqttPublishNeeded(QString,QByteArray)),
-                                        Qt::DirectConnection);
-                
-                LOG_INFO("Signal connections: publishMessage=%s, mqttPublishNeeded=%s",
-                         connection1 ? "SUCCESS" : "FAILED",
-                         connection2 ? "SUCCESS" : "FAILED");
-                
-                // Test the connection by sending a direct message
-                QTimer::singleShot(1000, this, [this, friendly_name]() {
-                    QByteArray testMsg = "{\"state\":\"ON\"}";
-                    QString testTopic = QString("zigbee2mqtt/%1/set").arg(friendly_name);
-                    LOG_INFO("[ZigbeeDeviceManager] Testing message to: %s", qUtf8Printable(testTopic));
-                    emit mqttPublishNeeded(testTopic, testMsg);
+            // Test the connection by sending a direct message
+            QTimer::singleShot(1000, this, [this, friendly_name]() {
+                QByteArray testMsg = "{\"state\":\"ON\"}";
+                QString testTopic = QString("zigbee2mqtt/%1/set").arg(friendly_name);
+                LOG_INFO("[ZigbeeDeviceManager] Testing message to: %s", qUtf8Printable(testTopic));
+                emit mqttPublishNeeded(testTopic, testMsg);
+            });
+            
+            devices[deviceTopic] = newDevice;
+
+            // Route this device's state topic straight to it
+            if (router) {
+                router->insert(deviceTopic, [this, newDevice](const QString&, const QByteArray& payload) {
+                    handleDeviceState(newDevice, payload);
                 });
-                
-                devices[deviceTopic] = newDevice;
-                
-                // Subscribe only to this device's state topic
-                emit mqttPublishNeeded(deviceTopic, QByteArray());  // Empty payload for subscribe
-            } else {
-                LOG_DEBUG("Zigbee device already exists: %s", qUtf8Printable(friendly_name));
             }
+            
+            // Subscribe only to this device's state topic
+            emit subscriptionNeeded(deviceTopic);
+            added++;
+        } else {
+            LOG_DEBUG("Zigbee device already exists: %s", qUtf8Printable(friendly_name));
         }
-        
+    }
+    
+    // One list rebuild for the whole device list
+    if (added > 0) {
         emit deviceListChanged();
-        return;
     }
+}
 
-    // Only process messages for known RGB light devices
-    if (devices.contains(topic)) {
-        devices[topic]->UpdateFromMQTT(payload);
+void ZigbeeDeviceManager::handleDeviceState(ZigbeeLightDevice* device, const QByteArray& payload)
+{
+    QMutexLocker locker(&device_mutex);
+
+    // Repeated payloads and states that only touch linkquality and the like do not
+    // change anything OpenRGB shows, so they must not trigger a device list rebuild
+    if (device->ApplyMQTTState(payload)) {
         emit deviceListChanged();
     }
 }
@@ -210,7 +258,24 @@ std::vector<RGBController*> ZigbeeDeviceManager::getDevices() const
     return result;
 }
 
+void ZigbeeDeviceManager::setStreamingPaused(bool paused)
+{
+    QMutexLocker locker(&device_mutex);
+    streaming_paused = paused;
+    for (ZigbeeLightDevice* device : devices) {
+        device->SetStreamingPaused(paused);
+    }
+}
+
 void ZigbeeDeviceManager::subscribeToTopics()
 {
-    // Already handled in discoverDevices()
+    // Held for the lifetime of the manager; the handler restores them after reconnects
+    if (topics_subscribed) {
+        return;
+    }
+    topics_subscribed = true;
+
+    emit subscriptionNeeded("zigbee2mqtt/bridge/state");
+    emit subscriptionNeeded("zigbee2mqtt/bridge/devices");
+    emit subscriptionNeeded("zigbee2mqtt/bridge/response/devices");
 }
\ No newline at end of file
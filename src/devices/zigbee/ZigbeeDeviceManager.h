@@ -4,8 +4,11 @@
 #include <QMap>
 #include <QString>
 #include <QMutex>
+#include <QThreadPool>
+#include <vector>
 #include "../DeviceManager.h"
 #include "ZigbeeLightDevice.h"
+#include "../../mqtt/TopicTrie.h"
 
 class ZigbeeDeviceManager : public QObject
 {
@@ -15,21 +18,35 @@ public:
     ZigbeeDeviceManager(QObject* parent = nullptr);
     virtual ~ZigbeeDeviceManager();
 
-    virtual void handleMQTTMessage(const QString& topic, const QByteArray& payload);
+    virtual void registerRoutes(TopicTrie& router);
     virtual void discoverDevices();
     virtual std::vector<RGBController*> getDevices() const;
 
+    // Forwarded to every device, including ones discovered while paused
+    void setStreamingPaused(bool paused);
+
 signals:
-    void mqttPublishNeeded(const QString& topic, const QByteArray& payload);
+    void mqttPublishNeeded(const QString& topic, const QByteArray& payload, const PublishOptions& options = PublishOptions());
     void deviceListChanged();
+    void subscriptionNeeded(const QString& filter);
+    void unsubscriptionNeeded(const QString& filter);
 
 protected:
     virtual void subscribeToTopics();
 
 private:
-bool isRGBLight(const QJsonObject& device) const;
+static bool isRGBLight(const QJsonObject& device);
+static std::vector<MQTTRGBDevice::LightInfo> parseDeviceList(const QByteArray& payload);
+void handleBridgeState(const QByteArray& payload);
+void handleDeviceList(const QByteArray& payload);
+void addDevices(const std::vector<MQTTRGBDevice::LightInfo>& lights);
+void handleDeviceState(ZigbeeLightDevice* device, const QByteArray& payload);
 QMap<QString, ZigbeeLightDevice*> devices;  // Map topic -> device
+TopicTrie* router = nullptr;                // Set by registerRoutes, per-device state routes go here
 bool bridge_state_known = false;
+bool topics_subscribed = false;
+bool streaming_paused = false;
     mutable QMutex device_mutex;
+    QThreadPool parse_pool;
 
 };
\ No newline at end of file
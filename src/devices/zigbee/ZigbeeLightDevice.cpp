@@ -3,6 +3,7 @@
 #include <QJsonDocument>
 #include <QJsonArray>
 #include "OpenRGB/LogManager.h"
+#include "utils/Trace.h"
 #include <cmath>
 
 ZigbeeLightDevice::ZigbeeLightDevice(const LightInfo& info)
@@ -26,6 +27,9 @@ ZigbeeLightDevice::ZigbeeLightDevice(const LightInfo& info)
     update_timer->setSingleShot(true);
     update_timer->setInterval(5); // 5ms interval for batching
     connect(update_timer, &QTimer::timeout, this, &ZigbeeLightDevice::sendDelayedUpdate);
+
+    publish_options.device_class = "ZigbeeLightDevice";
+    setProtocol("zigbee");
     
     // Initialize color caching variables
     last_r = 0;
@@ -40,6 +44,9 @@ void ZigbeeLightDevice::sendDelayedUpdate()
     if (!send_updates || colors.size() == 0) {
         return;
     }
+    if (skipWhilePaused()) {
+        return;
+    }
 
     // Extract RGB values from first LED
     unsigned char red = RGBGetRValue(colors[0]);
@@ -107,17 +114,12 @@ void ZigbeeLightDevice::sendDelayedUpdate()
     
     QByteArray data = jsonStr.toUtf8();
     
-    // Send the message directly to zigbee2mqtt topic
-    QString deviceName = QString::fromStdString(name);
-    QString setTopic = QString("zigbee2mqtt/%1/set").arg(deviceName);
-    
-    LOG_INFO("[ZigbeeLightDevice] Sending color [R:%d G:%d B:%d] to topic: %s", 
-             red, green, blue, qUtf8Printable(setTopic));
-    LOG_INFO("[ZigbeeLightDevice] Payload: %s", data.constData());
+    TRACE_DEBUG("zigbee", "delayed_update", colors[0], data.size());
     
     // Try both signal types to ensure delivery
-    emit publishMessage(setTopic, data);
-    emit mqttPublishNeeded(setTopic, data);
+    const PublishOptions options = frameOptions(PublishOptions::Streaming);
+    emit publishMessage(mqtt_topic, data, options);
+    emit mqttPublishNeeded(mqtt_topic, data, options);
 }
 
 void ZigbeeLightDevice::UpdateFromMQTT(const QByteArray& payload)
@@ -303,16 +305,12 @@ void ZigbeeLightDevice::PublishState()
         
         QByteArray data = jsonStr.toUtf8();
         
-        // Send directly to the zigbee topic
-        QString deviceName = QString::fromStdString(name);
-        QString setTopic = QString("zigbee2mqtt/%1/set").arg(deviceName);
-        
         LOG_INFO("[ZigbeeLightDevice] Publishing state to %s with payload: %s", 
-                 qUtf8Printable(setTopic), data.constData());
+                 qUtf8Printable(mqtt_topic), data.constData());
         
         // Send both signals
-        emit publishMessage(setTopic, data);
-        emit mqttPublishNeeded(setTopic, data);
+        emit publishMessage(mqtt_topic, data, publish_options);
+        emit mqttPublishNeeded(mqtt_topic, data, publish_options);
     }
 }
 
@@ -322,6 +320,8 @@ void ZigbeeLightDevice::DeviceUpdateLEDs()
     // Don't send updates if flag is off
     if (!send_updates || colors.size() == 0)
         return;
+    if (skipWhilePaused())
+        return;
         
     // Extract RGB values from first LED
     unsigned char red = RGBGetRValue(colors[0]);
@@ -346,12 +346,9 @@ void ZigbeeLightDevice::DeviceUpdateLEDs()
     QString jsonStr = QString("{\"state\":\"ON\",\"color\":{\"x\":%1,\"y\":%2}}").arg(x).arg(y);
     QByteArray data = jsonStr.toUtf8();
     
-    // Send directly to the zigbee topic
-    QString deviceName = QString::fromStdString(name);
-    QString setTopic = QString("zigbee2mqtt/%1/set").arg(deviceName);
-    
     // Send directly to MQTT
-    emit mqttPublishNeeded(setTopic, data);
+    TRACE_DEBUG("zigbee", "update_leds", colors[0], data.size());
+    emit mqttPublishNeeded(mqtt_topic, data, frameOptions(PublishOptions::Streaming));
 }
 
 // Streamlined RGB to CIE xy color space conversion
@@ -20,8 +20,8 @@ public:
 
 signals:
     // Both signal types for compatibility
-    void publishMessage(const QString& topic, const QByteArray& payload);
-    void mqttPublishNeeded(const QString& topic, const QByteArray& payload);
+    void publishMessage(const QString& topic, const QByteArray& payload, const PublishOptions& options = PublishOptions());
+    void mqttPublishNeeded(const QString& topic, const QByteArray& payload, const PublishOptions& options = PublishOptions());
 
 private slots:
     void sendDelayedUpdate();
@@ -0,0 +1,141 @@
+#include "BridgeMetrics.h"
+#include "MQTTHandler.h"
+#include "devices/DeviceManager.h"
+#include "utils/LatencyHistogram.h"
+#include "utils/StageMetrics.h"
+#include <QJsonDocument>
+#include <QDateTime>
+#include <map>
+#include "OpenRGB/LogManager.h"
+
+BridgeMetrics::BridgeMetrics(MQTTHandler* handler, DeviceManager* devices, QObject* parent)
+    : QObject(parent)
+    , handler(handler)
+    , devices(devices)
+    , timer(new QTimer(this))
+    , lastReceived(0)
+    , lastSent(0)
+{
+    connect(timer, &QTimer::timeout, this, &BridgeMetrics::publishMetrics);
+    sinceLast.start();
+}
+
+void BridgeMetrics::configure(int interval_sec, const QStringList& sections)
+{
+    enabledSections = sections;
+
+    if (interval_sec <= 0) {
+        timer->stop();
+        return;
+    }
+    timer->start(interval_sec * 1000);
+}
+
+void BridgeMetrics::setBaseTopic(const QString& base_topic)
+{
+    topic = QString("%1/bridge/metrics").arg(base_topic);
+}
+
+bool BridgeMetrics::wants(const char* section) const
+{
+    return enabledSections.isEmpty() || enabledSections.contains(QLatin1String(section));
+}
+
+QJsonObject BridgeMetrics::collect()
+{
+    const MQTTHandler::QueueStats queue = handler->queueStats();
+    const MQTTHandler::PublishStats publish = handler->publishStats();
+
+    // Rates cover the time since the previous collect
+    const double elapsed_s = sinceLast.restart() / 1000.0;
+    const quint64 received = queue.received - lastReceived;
+    const quint64 sent = publish.sent - lastSent;
+    lastReceived = queue.received;
+    lastSent = publish.sent;
+
+    QJsonObject doc;
+    doc["ts"] = QDateTime::currentMSecsSinceEpoch();
+
+    if (wants("rates")) {
+        QJsonObject rates;
+        rates["in_per_s"] = elapsed_s > 0 ? received / elapsed_s : 0.0;
+        rates["out_per_s"] = elapsed_s > 0 ? sent / elapsed_s : 0.0;
+        doc["rates"] = rates;
+    }
+
+    if (wants("queues")) {
+        QJsonObject queues;
+        queues["in_depth"] = static_cast<double>(queue.depth);
+        queues["in_high_water"] = static_cast<double>(queue.high_water);
+        queues["in_bytes"] = static_cast<double>(queue.queued_bytes);
+        queues["out_pending"] = publish.pending;
+        queues["out_pending_control"] = publish.pending_by_lane[PublishOptions::ControlLane];
+        queues["out_pending_discovery"] = publish.pending_by_lane[PublishOptions::DiscoveryLane];
+        queues["out_pending_streaming"] = publish.pending_by_lane[PublishOptions::StreamingLane];
+        queues["in_flight"] = publish.in_flight;
+        queues["offline_buffered"] = publish.offline_buffered;
+        queues["transport_bytes"] = static_cast<double>(publish.transport_backlog);
+        queues["backpressured"] = handler->isBackpressured();
+        doc["queues"] = queues;
+    }
+
+    if (wants("frames")) {
+        QJsonObject frames;
+        frames["coalesced"] = static_cast<double>(publish.coalesced);
+        frames["deferred"] = static_cast<double>(publish.deferred);
+        frames["throttled"] = static_cast<double>(publish.throttled);
+        frames["in_dropped"] = static_cast<double>(queue.dropped);
+        frames["offline_dropped"] = static_cast<double>(publish.offline_dropped);
+        doc["frames"] = frames;
+    }
+
+    if (wants("connection")) {
+        const MQTTHandler::ConnectionStats connection = handler->connectionStats();
+        QJsonObject conn;
+        conn["state"] = static_cast<int>(connection.state);
+        conn["recoveries"] = static_cast<double>(connection.recoveries);
+        conn["last_recovery_ms"] = static_cast<double>(connection.last_recovery_ms);
+        doc["connection"] = conn;
+    }
+
+    if (wants("latency")) {
+        doc["latency"] = Latency::report();
+    }
+
+    if (wants("stages")) {
+        doc["stages"] = StageMetrics::report();
+    }
+
+    if (wants("devices") && devices) {
+        std::map<std::string, int> per_protocol;
+        int enabled = 0;
+        const auto available = devices->getAllAvailableDevices();
+        for (const auto& device : available) {
+            per_protocol[device.second]++;
+            if (devices->isDeviceAddedToOpenRGB(device.first)) {
+                enabled++;
+            }
+        }
+
+        QJsonObject counts;
+        counts["total"] = static_cast<int>(available.size());
+        counts["enabled"] = enabled;
+        for (const auto& entry : per_protocol) {
+            counts[QString::fromStdString(entry.first)] = entry.second;
+        }
+        doc["devices"] = counts;
+    }
+
+    return doc;
+}
+
+void BridgeMetrics::publishMetrics()
+{
+    // Metrics describe the present - nothing is held back for a reconnect
+    if (topic.isEmpty() || !handler->isConnected()) {
+        return;
+    }
+
+    const QByteArray payload = QJsonDocument(collect()).toJson(QJsonDocument::Compact);
+    handler->publish(topic, payload, 0, false, true);
+}
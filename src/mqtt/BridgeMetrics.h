@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QJsonObject>
+
+class MQTTHandler;
+class DeviceManager;
+
+/*---------------------------------------------------------*\
+| BridgeMetrics                                             |
+|                                                           |
+| Periodically publishes a compact JSON document describing |
+| the bridge itself to <base_topic>/bridge/metrics, so a    |
+| broker-side monitor can alert on saturation. Everything   |
+| is read from counters the hot paths already keep; nothing |
+| is collected between ticks.                               |
+|                                                           |
+| Sections: rates, queues, frames, connection, latency,     |
+| stages, devices.                                          |
+\*---------------------------------------------------------*/
+
+class BridgeMetrics : public QObject
+{
+    Q_OBJECT
+
+public:
+    BridgeMetrics(MQTTHandler* handler, DeviceManager* devices, QObject* parent = nullptr);
+
+    // interval_sec 0 stops publishing; an empty section list publishes every section
+    void configure(int interval_sec, const QStringList& sections);
+    void setBaseTopic(const QString& base_topic);
+
+    // The document the next tick would publish
+    QJsonObject collect();
+
+private slots:
+    void publishMetrics();
+
+private:
+    MQTTHandler* handler;
+    DeviceManager* devices;
+    QTimer* timer;
+    QString topic;
+    QStringList enabledSections;
+
+    // Counter values at the previous tick, for the per-second rates
+    QElapsedTimer sinceLast;
+    quint64 lastReceived;
+    quint64 lastSent;
+
+    bool wants(const char* section) const;
+};
@@ -0,0 +1,554 @@
+#include "MQTTConnection.h"
+#include "OpenRGB/LogManager.h"
+#include "utils/Trace.h"
+#include "utils/StageMetrics.h"
+#include <QRandomGenerator>
+#include <QStringList>
+#include <QIODevice>
+#include <algorithm>
+
+namespace
+{
+    const int CONNECT_TIMEOUT_MS = 10000;   // Attempt abandoned if no CONNACK by then
+}
+
+MQTTConnection::MQTTConnection(QObject* parent)
+    : QObject(parent)
+    , client(nullptr)
+    , clientState(QMqttClient::Disconnected)
+    , link(Idle)
+    , brokerPort(1883)
+    , reconnectTimer(nullptr)
+    , connectTimer(nullptr)
+    , reconnectAttempt(0)
+    , backoffMinMs(1000)
+    , backoffMaxMs(60000)
+    , recoveryCount(0)
+    , lastRecoveryMs(-1)
+    , protocolVersion(QMqttClient::MQTT_5_0)
+    , topicAliasLimit(16)
+    , aliasedCount(0)
+    , aliasSavedBytes(0)
+    , clientId("openrgb2mqtt")
+    , persistentSession(true)
+    , sessionExpirySec(3600)
+    , inFlightMax(16)
+    , inFlightSize(0)
+    , transportBytes(0)
+{
+}
+
+MQTTConnection::~MQTTConnection()
+{
+    delete client;
+}
+
+QMqttClient::ClientState MQTTConnection::state() const
+{
+    return static_cast<QMqttClient::ClientState>(clientState.load());
+}
+
+void MQTTConnection::initialize()
+{
+    if (client) {
+        return;
+    }
+
+    // Created here so the client and its socket belong to the network thread
+    client = new QMqttClient();
+
+    connect(client, &QMqttClient::stateChanged, this, [this](QMqttClient::ClientState state) {
+        clientState.store(state);
+        if (state == QMqttClient::Disconnected) {
+            handleLinkDown();
+        }
+    });
+    connect(client, &QMqttClient::connected, this, &MQTTConnection::handleConnected);
+    connect(client, &QMqttClient::disconnected, this, &MQTTConnection::disconnected);
+    connect(client, &QMqttClient::messageReceived, this, &MQTTConnection::messageReceived);
+    connect(client, &QMqttClient::messageSent, this, &MQTTConnection::handleMessageSent);
+    connect(client, &QMqttClient::errorChanged, this, &MQTTConnection::handleError);
+
+    client->setProtocolVersion(protocolVersion);
+    client->setKeepAlive(60);
+
+    reconnectTimer = new QTimer(this);
+    reconnectTimer->setSingleShot(true);
+    connect(reconnectTimer, &QTimer::timeout, this, &MQTTConnection::attemptConnect);
+
+    connectTimer = new QTimer(this);
+    connectTimer->setSingleShot(true);
+    connectTimer->setInterval(CONNECT_TIMEOUT_MS);
+    connect(connectTimer, &QTimer::timeout, this, &MQTTConnection::handleConnectTimeout);
+}
+
+void MQTTConnection::setProtocol(QMqttClient::ProtocolVersion version, quint16 topic_alias_limit)
+{
+    protocolVersion = version;
+    topicAliasLimit = topic_alias_limit;
+}
+
+void MQTTConnection::setSession(const QString& client_id, bool persistent, quint32 expiry_sec)
+{
+    clientId = client_id.isEmpty() ? QString("openrgb2mqtt") : client_id;
+    persistentSession = persistent;
+    sessionExpirySec = expiry_sec;
+}
+
+void MQTTConnection::setInFlightWindow(int max_in_flight)
+{
+    inFlightMax = max_in_flight > 0 ? max_in_flight : 1;
+    fillWindow();
+}
+
+void MQTTConnection::setReconnectBackoff(int min_msec, int max_msec)
+{
+    backoffMinMs = qMax(100, min_msec);
+    backoffMaxMs = qMax(backoffMinMs, max_msec);
+}
+
+void MQTTConnection::handleConnected()
+{
+    connectTimer->stop();
+    link.store(Online);
+    reconnectAttempt = 0;
+
+    // Aliases don't survive a connection - size the table to what this broker allows
+    quint16 alias_limit = 0;
+    if (client->protocolVersion() == QMqttClient::MQTT_5_0) {
+        alias_limit = qMin(client->serverConnectionProperties().maximumTopicAlias(), topicAliasLimit);
+        LOG_INFO("[MQTTHandler] Connected with MQTT 5, using %d topic aliases", alias_limit);
+    }
+    topicAliases.reset(alias_limit);
+
+    // Anything not acknowledged on the old connection goes out again first, in its original order
+    if (!inFlight.isEmpty()) {
+        LOG_INFO("[MQTTHandler] Resending %d unacknowledged publishes", inFlight.size());
+        for (auto it = inFlight.constEnd(); it != inFlight.constBegin();) {
+            --it;
+            windowQueue.push_front(it.value());
+        }
+        inFlight.clear();
+        inFlightSize.store(0);
+    }
+
+    // The client creates a fresh socket per connection
+    if (QIODevice* transport = client->transport()) {
+        connect(transport, &QIODevice::bytesWritten, this, &MQTTConnection::updateTransportBacklog,
+                Qt::UniqueConnection);
+    }
+
+    // A persistent session may hold filters we dropped while offline; a clean one holds none
+    syncSubscriptions(true);
+
+    emit connected();
+
+    if (outage.isValid()) {
+        const qint64 outage_ms = outage.elapsed();
+        outage.invalidate();
+        lastRecoveryMs.store(outage_ms);
+        recoveryCount++;
+        LOG_INFO("[MQTTHandler] Connection recovered after %lld ms", static_cast<long long>(outage_ms));
+        emit recovered(outage_ms);
+    }
+
+    fillWindow();
+}
+
+void MQTTConnection::handleLinkDown()
+{
+    connectTimer->stop();
+    transportBytes.store(0);
+
+    const LinkState state = linkState();
+    if (state == Idle || state == Backoff) {
+        return;
+    }
+
+    if (state == Online) {
+        LOG_WARNING("[MQTTHandler] Lost connection to %s:%d", qUtf8Printable(brokerHost), brokerPort);
+        outage.start();
+    }
+
+    scheduleReconnect();
+}
+
+void MQTTConnection::scheduleReconnect()
+{
+    // Exponential backoff with jitter, so a restarted broker isn't hit by every client at once
+    const int shift = qMin(reconnectAttempt, 16);
+    const qint64 ceiling = qMin<qint64>(static_cast<qint64>(backoffMinMs) << shift, backoffMaxMs);
+    const int delay = static_cast<int>(ceiling / 2 + QRandomGenerator::global()->bounded(static_cast<int>(ceiling / 2) + 1));
+    reconnectAttempt++;
+
+    LOG_INFO("[MQTTHandler] Reconnecting to %s:%d in %d ms (attempt %d)",
+             qUtf8Printable(brokerHost), brokerPort, delay, reconnectAttempt);
+
+    link.store(Backoff);
+    reconnectTimer->start(delay);
+}
+
+void MQTTConnection::handleConnectTimeout()
+{
+    if (linkState() != Connecting) {
+        return;
+    }
+
+    LOG_WARNING("[MQTTHandler] No response from %s:%d after %d ms",
+                qUtf8Printable(brokerHost), brokerPort, CONNECT_TIMEOUT_MS);
+
+    // Dropping the half-open attempt reports Disconnected, which schedules the retry
+    if (client->state() != QMqttClient::Disconnected) {
+        client->disconnectFromHost();
+    } else {
+        scheduleReconnect();
+    }
+}
+
+void MQTTConnection::syncSubscriptions(bool resend)
+{
+    if (!client || client->state() != QMqttClient::Connected) {
+        return;
+    }
+
+    // QtMqtt sends one SUBSCRIBE per filter, so ask for as few filters as possible
+    const QMap<QString, quint8> wanted = minimalFilters();
+    QMap<QString, quint8> held;
+    int subscribed = 0;
+    int unsubscribed = 0;
+
+    for (auto it = wanted.constBegin(); it != wanted.constEnd(); ++it) {
+        auto active = activeFilters.constFind(it.key());
+        if (!resend && active != activeFilters.constEnd() && active.value() == it.value()) {
+            held.insert(it.key(), it.value());
+            continue;
+        }
+        if (client->subscribe(QMqttTopicFilter(it.key()), it.value())) {
+            held.insert(it.key(), it.value());
+            subscribed++;
+        } else {
+            // Left out of activeFilters so the next sync asks again
+            LOG_WARNING("[MQTTHandler] Failed to subscribe to: %s", qUtf8Printable(it.key()));
+        }
+    }
+
+    for (auto it = activeFilters.constBegin(); it != activeFilters.constEnd(); ++it) {
+        if (!wanted.contains(it.key())) {
+            client->unsubscribe(QMqttTopicFilter(it.key()));
+            unsubscribed++;
+        }
+    }
+
+    activeFilters = held;
+
+    if (subscribed > 0 || unsubscribed > 0) {
+        LOG_INFO("[MQTTHandler] Subscriptions updated: %d subscribed, %d unsubscribed, %d covered by broader filters",
+                 subscribed, unsubscribed, subscriptions.size() - wanted.size());
+    }
+}
+
+QMap<QString, quint8> MQTTConnection::minimalFilters() const
+{
+    // Anything already matched by a broader filter of at least the same QoS is left out
+    QMap<QString, quint8> wanted;
+    for (auto it = subscriptions.constBegin(); it != subscriptions.constEnd(); ++it) {
+        bool redundant = false;
+        for (auto other = subscriptions.constBegin(); other != subscriptions.constEnd(); ++other) {
+            if (other.value() >= it.value() && filterCovers(other.key(), it.key())) {
+                redundant = true;
+                break;
+            }
+        }
+        if (!redundant) {
+            wanted.insert(it.key(), it.value());
+        }
+    }
+    return wanted;
+}
+
+bool MQTTConnection::filterCovers(const QString& filter, const QString& other)
+{
+    if (filter == other) {
+        return false;
+    }
+
+    // True if every topic matched by other is also matched by filter
+    const QStringList levels = filter.split('/');
+    const QStringList other_levels = other.split('/');
+
+    for (int i = 0; i < levels.size(); i++) {
+        if (levels[i] == "#") {
+            return true;
+        }
+        if (i >= other_levels.size() || other_levels[i] == "#") {
+            return false;
+        }
+        if (levels[i] != "+" && levels[i] != other_levels[i]) {
+            return false;
+        }
+    }
+
+    return levels.size() == other_levels.size();
+}
+
+void MQTTConnection::handleMessageSent(qint32 id)
+{
+    // PUBACK (QoS 1) or PUBCOMP (QoS 2) - frees a slot in the window
+    if (inFlight.remove(id) > 0) {
+        inFlightSize.store(inFlight.size());
+        fillWindow();
+    }
+}
+
+void MQTTConnection::connectToHost(const QString& host, quint16 port,
+                                   const QString& username, const QString& password)
+{
+    // Drop any current connection without it counting as an outage
+    link.store(Idle);
+    reconnectTimer->stop();
+    outage.invalidate();
+    if (client->state() != QMqttClient::Disconnected) {
+        client->disconnectFromHost();
+    }
+
+    brokerHost = host;
+    brokerPort = port;
+    brokerUsername = username;
+    brokerPassword = password;
+    reconnectAttempt = 0;
+
+    if (!username.isEmpty()) {
+        LOG_INFO("[MQTTHandler] Using username: %s", qUtf8Printable(username));
+        if (!password.isEmpty()) {
+            LOG_INFO("[MQTTHandler] Password provided");
+        }
+    }
+
+    attemptConnect();
+}
+
+void MQTTConnection::attemptConnect()
+{
+    // Basic settings
+    client->setHostname(brokerHost);
+    client->setPort(brokerPort);
+    client->setProtocolVersion(protocolVersion);
+
+    // Stable client ID so a persistent session can be resumed
+    client->setClientId(clientId);
+
+    // Authentication
+    client->setUsername(brokerUsername);
+    client->setPassword(brokerPassword);
+
+    // Connection flags - MQTT 5 ends the session on disconnect unless it is given an expiry
+    client->setCleanSession(!persistentSession);
+    if (protocolVersion == QMqttClient::MQTT_5_0) {
+        QMqttConnectionProperties properties = client->connectionProperties();
+        properties.setSessionExpiryInterval(persistentSession ? sessionExpirySec : 0);
+        client->setConnectionProperties(properties);
+    }
+
+    // Try to connect
+    LOG_INFO("[MQTTHandler] Connecting to MQTT broker %s:%d...", qUtf8Printable(brokerHost), brokerPort);
+    link.store(Connecting);
+    connectTimer->start();
+    client->connectToHost();
+}
+
+void MQTTConnection::disconnectFromHost(const QString& will_topic)
+{
+    // Planned - stop the state machine before the client reports Disconnected
+    link.store(Idle);
+    if (reconnectTimer) {
+        reconnectTimer->stop();
+        connectTimer->stop();
+    }
+    outage.invalidate();
+
+    if (client && client->state() != QMqttClient::Disconnected) {
+        LOG_INFO("MQTT: Disconnecting...");
+        if (!will_topic.isEmpty() && client->state() == QMqttClient::Connected) {
+            publishOne({will_topic, "offline", 0, false});
+        }
+        client->disconnectFromHost();
+    }
+}
+
+void MQTTConnection::publishBatch(const std::vector<Publish>& batch)
+{
+    for (const Publish& message : batch) {
+        if (message.qos == 0) {
+            publishOne(message);
+        } else if (windowQueue.empty() && inFlight.size() < inFlightMax) {
+            sendReliable(message);
+        } else {
+            // Merged per topic like OutboundQueue, so the queue is bounded by the topic count
+            // and a newer state takes the place of one that never went out
+            auto queued = std::find_if(windowQueue.rbegin(), windowQueue.rend(), [&message](const Publish& held) {
+                return held.topic == message.topic;
+            });
+            if (queued != windowQueue.rend()) {
+                *queued = message;
+            } else {
+                windowQueue.push_back(message);
+            }
+        }
+    }
+
+    updateTransportBacklog();
+}
+
+void MQTTConnection::updateTransportBacklog()
+{
+    QIODevice* transport = client ? client->transport() : nullptr;
+    transportBytes.store(transport && link.load() == Online ? transport->bytesToWrite() : 0);
+}
+
+bool MQTTConnection::sendReliable(const Publish& message)
+{
+    const qint32 id = publishOne(message);
+    if (id <= 0) {
+        // Not connected or refused - hold it for the next connection
+        windowQueue.push_front(message);
+        return false;
+    }
+
+    inFlight.insert(id, message);
+    inFlightSize.store(inFlight.size());
+    return true;
+}
+
+void MQTTConnection::fillWindow()
+{
+    if (!client || client->state() != QMqttClient::Connected) {
+        return;
+    }
+
+    while (!windowQueue.empty() && inFlight.size() < inFlightMax) {
+        Publish message = std::move(windowQueue.front());
+        windowQueue.pop_front();
+        if (!sendReliable(message)) {
+            break;
+        }
+    }
+}
+
+qint32 MQTTConnection::publishOne(const Publish& message)
+{
+    if (client->state() != QMqttClient::Connected) {
+        LOG_WARNING("[MQTTHandler] Cannot publish when not connected. Topic: %s", qUtf8Printable(message.topic));
+        return -1;
+    }
+
+    // Devices hand over a topic name built once at creation, everything else builds one here.
+    // The device's string is shared with message.topic, so the check is a pointer compare.
+    const QMqttTopicName topic_name = (message.topic_name.name() == message.topic) ? message.topic_name
+                                                                                   : QMqttTopicName(message.topic);
+
+    // Frequently published topics go out under an alias once the broker has seen the full name
+    bool remapped = false;
+    const quint16 alias = topicAliases.aliasFor(message.topic, remapped);
+
+    // Streaming frames expire at the broker instead of arriving late
+    const bool expires = message.expiry > 0 && client->protocolVersion() == QMqttClient::MQTT_5_0;
+
+    const qint64 publish_start_ns = Latency::nowNs();
+    qint32 result;
+    if (alias > 0 || expires) {
+        QMqttPublishProperties properties;
+        if (alias > 0) {
+            properties.setTopicAlias(alias);
+        }
+        if (expires) {
+            properties.setMessageExpiryInterval(message.expiry);
+        }
+        result = client->publish(topic_name, properties, message.payload, message.qos, message.retain);
+
+        // The alias property costs 3 bytes; a reused alias replaces the whole topic string
+        if (alias > 0 && result != -1) {
+            aliasedCount++;
+            aliasSavedBytes += remapped ? -3 : message.topic.toUtf8().size() - 3;
+        }
+    } else {
+        result = client->publish(topic_name, message.payload, message.qos, message.retain);
+    }
+    const qint64 publish_end_ns = Latency::nowNs();
+    StageMetrics::record(StageMetrics::ClientPublish, publish_end_ns - publish_start_ns);
+
+    if (result == -1) {
+        TRACE_ERROR("mqtt", "publish_failed", message.payload.size(), message.qos);
+        LOG_ERROR("[MQTTHandler] Failed to publish to topic: %s", qUtf8Printable(message.topic));
+        return -1;
+    }
+
+    TRACE_INFO("mqtt", "publish", message.payload.size(), message.qos);
+    if (message.latency && message.origin_ns > 0) {
+        message.latency->record(publish_end_ns - message.origin_ns);
+    }
+    return result;
+}
+
+void MQTTConnection::subscribe(const QString& topic, quint8 qos)
+{
+    auto existing = subscriptions.constFind(topic);
+    if (existing != subscriptions.constEnd() && existing.value() >= qos) {
+        return;
+    }
+
+    QMap<QString, quint8> added;
+    added.insert(topic, qos);
+    updateSubscriptions(added, QStringList());
+}
+
+void MQTTConnection::updateSubscriptions(const QMap<QString, quint8>& added, const QStringList& removed)
+{
+    // Remembered either way - the next connect diffs against the broker
+    for (const QString& filter : removed) {
+        subscriptions.remove(filter);
+    }
+    for (auto it = added.constBegin(); it != added.constEnd(); ++it) {
+        subscriptions.insert(it.key(), it.value());
+    }
+
+    syncSubscriptions(false);
+}
+
+void MQTTConnection::handleError()
+{
+    QString errorMsg;
+    auto error = client->error();
+    switch (error) {
+        case QMqttClient::NoError:
+            return;
+        case QMqttClient::InvalidProtocolVersion:
+            errorMsg = "Invalid protocol version";
+            if (protocolVersion == QMqttClient::MQTT_5_0) {
+                // Older brokers only speak 3.1.1 - fall back for the next attempt
+                LOG_WARNING("[MQTTHandler] Broker rejected MQTT 5, falling back to MQTT 3.1.1");
+                protocolVersion = QMqttClient::MQTT_3_1_1;
+            }
+            break;
+        case QMqttClient::IdRejected:
+            errorMsg = "Client ID rejected";
+            break;
+        case QMqttClient::ServerUnavailable:
+            errorMsg = "Server unavailable";
+            break;
+        case QMqttClient::BadUsernameOrPassword:
+            errorMsg = "Bad username or password";
+            break;
+        case QMqttClient::NotAuthorized:
+            errorMsg = "Not authorized";
+            break;
+        case QMqttClient::TransportInvalid:
+            errorMsg = "Network error";
+            break;
+        default:
+            errorMsg = QString("Unknown error: %1").arg(static_cast<int>(error));
+            break;
+    }
+
+    LOG_ERROR("MQTT Error: %s", qUtf8Printable(errorMsg));
+    emit connectionError(errorMsg);
+}
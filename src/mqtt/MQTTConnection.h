@@ -0,0 +1,164 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QMap>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QtMqtt/qmqttclient.h>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include "TopicAliasTable.h"
+#include "utils/LatencyHistogram.h"
+
+/*---------------------------------------------------------*\
+| MQTTConnection                                            |
+|                                                           |
+| Owns one QMqttClient and lives on one of MQTTHandler's    |
+| network threads. Every method here runs on that thread;   |
+| the GUI side reaches it only through queued invocations   |
+| made by MQTTHandler. The accessors above the slots are    |
+| the only thread-safe members.                             |
+|                                                           |
+| Once connectToHost has been called the connection keeps   |
+| itself up: a lost or failed connection is retried with    |
+| jittered exponential backoff until disconnectFromHost.    |
+| The wanted subscriptions are kept here and diffed against |
+| what the broker holds whenever either side changes.       |
+\*---------------------------------------------------------*/
+
+class MQTTConnection : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum LinkState {
+        Idle,           // Not wanted - disconnectFromHost or never connected
+        Connecting,     // Waiting for CONNACK
+        Online,
+        Backoff         // Waiting to retry
+    };
+
+    struct Publish {
+        QString topic;
+        QByteArray payload;
+        quint8 qos;
+        bool retain;
+        quint32 expiry = 0;     // MQTT 5 Message Expiry Interval in seconds, 0 never expires
+        QMqttTopicName topic_name;  // Reused from the device when it has one
+        qint64 origin_ns = 0;       // Recorded into latency once written, see PublishOptions
+        LatencyHistogram* latency = nullptr;
+    };
+
+    explicit MQTTConnection(QObject* parent = nullptr);
+    ~MQTTConnection();
+
+    // Thread-safe snapshot of the client state
+    QMqttClient::ClientState state() const;
+
+    // Thread-safe counters for MQTT 5 topic aliasing
+    quint64 aliasedPublishes() const { return aliasedCount.load(); }
+    qint64 aliasBytesSaved() const { return aliasSavedBytes.load(); }
+
+    // Thread-safe count of QoS 1+ publishes waiting for their acknowledgement
+    int inFlightCount() const { return inFlightSize.load(); }
+
+    // Thread-safe count of bytes written to the socket but not yet sent - the backpressure signal
+    qint64 transportBacklog() const { return transportBytes.load(); }
+
+    // Thread-safe reconnect metrics
+    LinkState linkState() const { return static_cast<LinkState>(link.load()); }
+    quint64 recoveries() const { return recoveryCount.load(); }
+    qint64 lastRecoveryMsec() const { return lastRecoveryMs.load(); }
+
+public slots:
+    // Creates the client - runs once when the network thread starts
+    void initialize();
+
+    // Takes effect on the next connectToHost
+    void setProtocol(QMqttClient::ProtocolVersion version, quint16 topic_alias_limit);
+    void setSession(const QString& client_id, bool persistent, quint32 expiry_sec);
+    void setInFlightWindow(int max_in_flight);
+    void setReconnectBackoff(int min_msec, int max_msec);
+
+    void connectToHost(const QString& host, quint16 port,
+                       const QString& username, const QString& password);
+    void disconnectFromHost(const QString& will_topic);
+    void publishBatch(const std::vector<Publish>& batch);
+    void subscribe(const QString& topic, quint8 qos);
+    void updateSubscriptions(const QMap<QString, quint8>& added, const QStringList& removed);
+
+signals:
+    // Emitted on the network thread - connect with Qt::DirectConnection to consume there
+    void messageReceived(const QByteArray& message, const QMqttTopicName& topic);
+    void connected();
+    void disconnected();
+    void connectionError(const QString& error);
+
+    // Back online after an unplanned disconnect, subscriptions already restored
+    void recovered(qint64 outage_msec);
+
+private slots:
+    void attemptConnect();
+    void handleConnectTimeout();
+    void handleConnected();
+    void handleMessageSent(qint32 id);
+    void updateTransportBacklog();
+    void handleError();
+
+private:
+    QMqttClient* client;
+    std::atomic<int> clientState;
+
+    // Reconnect state machine
+    std::atomic<int> link;
+    QString brokerHost;
+    quint16 brokerPort;
+    QString brokerUsername;
+    QString brokerPassword;
+    QTimer* reconnectTimer;
+    QTimer* connectTimer;               // Gives up on an attempt that never gets a CONNACK
+    int reconnectAttempt;
+    int backoffMinMs;
+    int backoffMaxMs;
+    QElapsedTimer outage;               // Running from the unplanned disconnect until recovery
+    std::atomic<quint64> recoveryCount;
+    std::atomic<qint64> lastRecoveryMs;
+
+    // Every filter asked for, and what the broker was last told to hold for us
+    QMap<QString, quint8> subscriptions;
+    QMap<QString, quint8> activeFilters;
+
+    QMqttClient::ProtocolVersion protocolVersion;
+    quint16 topicAliasLimit;            // Our own cap on top of the broker's Topic Alias Maximum
+    TopicAliasTable topicAliases;
+    std::atomic<quint64> aliasedCount;
+    std::atomic<qint64> aliasSavedBytes;
+
+    // Session - a stable client ID lets the broker keep subscriptions and queued messages
+    QString clientId;
+    bool persistentSession;
+    quint32 sessionExpirySec;
+
+    // QoS 1+ in-flight window - unacknowledged publishes are resent after a reconnect
+    int inFlightMax;
+    QMap<qint32, Publish> inFlight;     // packet id -> publish, ascending id is send order
+    std::deque<Publish> windowQueue;    // Waiting for room in the window, merged per topic
+    std::atomic<int> inFlightSize;
+
+    // QMqttClient hands everything to its socket at once; this is what the socket still holds
+    std::atomic<qint64> transportBytes;
+
+    // Returns the packet id, 0 for QoS 0, or -1 on failure
+    qint32 publishOne(const Publish& message);
+    bool sendReliable(const Publish& message);
+    void fillWindow();
+
+    void handleLinkDown();
+    void scheduleReconnect();
+    void syncSubscriptions(bool resend);
+    QMap<QString, quint8> minimalFilters() const;
+    static bool filterCovers(const QString& filter, const QString& other);
+};
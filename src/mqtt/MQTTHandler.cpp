@@ -1,53 +1,128 @@
 #include "MQTTHandler.h"
 #include "OpenRGB/LogManager.h"
+#include "utils/Trace.h"
+#include "utils/StageMetrics.h"
 #include <QRandomGenerator>
-#include <QMutexLocker>
 #include <QJsonObject>
 #include <QJsonDocument>
+#include <QElapsedTimer>
+
+namespace
+{
+    // Ring slot plus the heap headers behind the topic and payload of one inbound message
+    const qint64 MESSAGE_OVERHEAD = 128;
+
+    const qint64 RING_SLOTS_MIN = 4096;
+    const qint64 RING_SLOTS_MAX = 1 << 20;
+    const qint64 RING_SLOTS_UNCAPPED = 1 << 16;
+}
 
 MQTTHandler::MQTTHandler(QObject* parent)
     : QObject(parent)
-    , client(new QMqttClient(this))
-    , processTimer(new QTimer(this))
-{
-    // Connect state changes
-    connect(client, &QMqttClient::connected, this, [this]() {
-        QMutexLocker locker(&mutex);
-        // Connected to broker
-        if (!willTopic.isEmpty()) {
-            publish(willTopic, "online");
-        }
-        emit connectionStatusChanged(true);
+    , connection(nullptr)
+    , drainScheduled(false)
+    , receivedMessages(0)
+    , droppedMessages(0)
+    , highWaterMark(0)
+    , queuedBytes(0)
+    , maxQueuedBytes(16 * 1024 * 1024)
+    , overflowPolicy(DropNewest)
+    , overflowLogged(false)
+    , drainBudgetUsec(2000)
+    , flushTimer(new QTimer(this))
+    , publishesQueued(0)
+    , publishesCoalesced(0)
+    , publishesDeferred(0)
+    , publishesSent(0)
+    , streamingExpirySec(1)
+    , finalStateQos(1)
+    , offlineMaxBytes(1024 * 1024)
+    , offlineDropped(0)
+    , backpressureHighBytes(256 * 1024)
+    , backpressureLowBytes(64 * 1024)
+    , backpressured(false)
+    , publishesThrottled(0)
+    , subscriptionFlushScheduled(false)
+{
+    rateClock.start();
 
-        // Subscribe to essential topics for auto-discovery
-        subscribe("homeassistant/light/#", true);
-        subscribe("homeassistant/+/light/+/config", true);
-    }, Qt::QueuedConnection);
-    
-    connect(client, &QMqttClient::disconnected, this, [this]() {
-        QMutexLocker locker(&mutex);
-        // Disconnected from broker
-        emit connectionStatusChanged(false);
-    }, Qt::QueuedConnection);
+    connection = startConnection();
 
-    // Connect to messages
-    connect(client, &QMqttClient::messageReceived, this, &MQTTHandler::handleMessage);
+    // Connection state crosses to this thread as queued signals
+    connect(connection, &MQTTConnection::connected, this, &MQTTHandler::handleConnected, Qt::QueuedConnection);
+    connect(connection, &MQTTConnection::disconnected, this, &MQTTHandler::handleDisconnected, Qt::QueuedConnection);
+    connect(connection, &MQTTConnection::connectionError, this, [this](const QString& error) {
+        lastError = error;
+        emit connectionError(error);
+    }, Qt::QueuedConnection);
+    connect(connection, &MQTTConnection::recovered, this, &MQTTHandler::connectionRecovered, Qt::QueuedConnection);
 
-    // Set up message processing timer with appropriate interval
-    processTimer->setInterval(10);  // Process messages every 10ms for efficient batching
-    connect(processTimer, &QTimer::timeout, this, [this]() {
-        processMessageQueue();
-    });
-    processTimer->start();
+    // Inbound messages are queued straight from the network thread
+    connect(connection, &MQTTConnection::messageReceived, this, &MQTTHandler::handleMessage, Qt::DirectConnection);
 
-    client->setProtocolVersion(QMqttClient::MQTT_3_1_1);
-    client->setKeepAlive(60);
+    // Outbound flush tick - only armed while publishes are pending
+    flushTimer->setSingleShot(true);
+    flushTimer->setInterval(16);
+    connect(flushTimer, &QTimer::timeout, this, &MQTTHandler::flushPendingPublishes);
 }
 
 MQTTHandler::~MQTTHandler()
 {
-    disconnect();
-    delete client;
+    for (size_t i = 0; i < connections.size(); i++) {
+        if (!networkThreads[i]->isRunning()) {
+            continue;
+        }
+
+        // Block once at shutdown so the offline status and DISCONNECT leave before the thread stops
+        QString will_topic = (i == 0) ? willTopic : QString();
+        MQTTConnection* conn = connections[i];
+        QMetaObject::invokeMethod(conn, [conn, will_topic]() {
+            conn->disconnectFromHost(will_topic);
+        }, Qt::BlockingQueuedConnection);
+
+        networkThreads[i]->quit();
+        networkThreads[i]->wait();
+    }
+}
+
+MQTTConnection* MQTTHandler::startConnection()
+{
+    QThread* thread = new QThread(this);
+    MQTTConnection* conn = new MQTTConnection();
+
+    // The client is created on the network thread once it starts
+    thread->setObjectName(connections.empty() ? QString("OpenRGB2MQTT Network")
+                                              : QString("OpenRGB2MQTT Network %1").arg(connections.size()));
+    conn->moveToThread(thread);
+    connect(thread, &QThread::started, conn, &MQTTConnection::initialize);
+    connect(thread, &QThread::finished, conn, &QObject::deleteLater);
+
+    networkThreads.push_back(thread);
+    connections.push_back(conn);
+    thread->start();
+    return conn;
+}
+
+void MQTTHandler::invokeOnAll(const std::function<void(MQTTConnection*)>& call)
+{
+    for (MQTTConnection* conn : connections) {
+        QMetaObject::invokeMethod(conn, [conn, call]() {
+            call(conn);
+        }, Qt::QueuedConnection);
+    }
+}
+
+void MQTTHandler::setConnectionPoolSize(int size)
+{
+    // Extra connections only publish - the primary keeps subscriptions and status
+    while (static_cast<int>(connections.size()) < size) {
+        startConnection();
+    }
+
+    if (connections.size() > 1) {
+        LOG_INFO("[MQTTHandler] Sharding publishes across %d broker connections",
+                 static_cast<int>(connections.size()));
+    }
 }
 
 void MQTTHandler::setWillMessage(const QString& topic, const QString& message)
@@ -56,6 +131,26 @@ void MQTTHandler::setWillMessage(const QString& topic, const QString& message)
     willMessage = message;
 }
 
+void MQTTHandler::setProtocol(QMqttClient::ProtocolVersion version, quint16 topic_alias_limit)
+{
+    invokeOnAll([version, topic_alias_limit](MQTTConnection* conn) {
+        conn->setProtocol(version, topic_alias_limit);
+    });
+}
+
+void MQTTHandler::setSession(const QString& client_id, bool persistent, quint32 expiry_sec)
+{
+    // Every pooled connection needs its own client ID, the broker drops duplicates
+    const QString base_id = client_id.isEmpty() ? QString("openrgb2mqtt") : client_id;
+    for (size_t i = 0; i < connections.size(); i++) {
+        MQTTConnection* conn = connections[i];
+        const QString shard_id = (i == 0) ? base_id : QString("%1-%2").arg(base_id).arg(i);
+        QMetaObject::invokeMethod(conn, [conn, shard_id, persistent, expiry_sec]() {
+            conn->setSession(shard_id, persistent, expiry_sec);
+        }, Qt::QueuedConnection);
+    }
+}
+
 bool MQTTHandler::connectToHost(const QString& host, quint16 port,
                          const QString& username, const QString& password)
 {
@@ -68,208 +163,557 @@ bool MQTTHandler::connectToHost(const QString& host, quint16 port,
         return false;
     }
 
-    // Disconnect if already connected
-    if (client->state() != QMqttClient::Disconnected) {
-        client->disconnectFromHost();
+    invokeOnAll([host, port, username, password](MQTTConnection* conn) {
+        conn->connectToHost(host, port, username, password);
+    });
+
+    return true;
+}
+
+void MQTTHandler::disconnect()
+{
+    const MQTTConnection* primary = connection;
+    QString will_topic = willTopic;
+    invokeOnAll([primary, will_topic](MQTTConnection* conn) {
+        conn->disconnectFromHost(conn == primary ? will_topic : QString());
+    });
+}
+
+bool MQTTHandler::isConnected() const
+{
+    return connection->state() == QMqttClient::Connected;
+}
+
+void MQTTHandler::handleConnected()
+{
+    // Connected to broker
+    if (!willTopic.isEmpty()) {
+        publish(willTopic, "online");
     }
+    emit connectionStatusChanged(true);
 
-    // Basic settings
-    client->setHostname(host);
-    client->setPort(port);
-    
-    // Use a simpler client ID
-    client->setClientId("openrgb2mqtt");
-
-    // Authentication
-    if (!username.isEmpty()) {
-        client->setUsername(username);
-        LOG_INFO("[MQTTHandler] Using username: %s", qUtf8Printable(username));
-        if (!password.isEmpty()) {
-            client->setPassword(password);
-            LOG_INFO("[MQTTHandler] Password provided");
+    // Replay what was intended while offline through the normal rate-limited flush
+    if (!offlineStates.isEmpty()) {
+        LOG_INFO("[MQTTHandler] Replaying last state for %d topics after reconnect", offlineStates.size());
+        for (const OutboundQueue::Entry& entry : offlineStates.takeAll()) {
+            enqueuePending(entry.topic, entry.payload, entry.options);
         }
+        flushTimer->start();
     }
+}
+
+void MQTTHandler::handleDisconnected()
+{
+    // Disconnected from broker
+    emit connectionStatusChanged(false);
+}
 
-    // Will message (disable for testing)
-    //if (!willTopic.isEmpty()) {
-    //    client->setWillTopic(willTopic);
-    //    client->setWillMessage(willMessage.toUtf8());
-    //    client->setWillQoS(1);
-    //    client->setWillRetain(true);
-    //}
+bool MQTTHandler::publish(const QString& topic, const QByteArray& payload, quint8 qos, bool retain, bool silent)
+{
+    if (!isConnected()) {
+        if (!silent) {
+            LOG_WARNING("[MQTTHandler] Not connected, holding publish until reconnect. Topic: %s", qUtf8Printable(topic));
+        }
 
-    // Connection flags
-    client->setCleanSession(true);
+        PublishOptions options;
+        options.qos = qos;
+        options.retain = retain;
+        bufferOffline(topic, payload, options);
+        return false;
+    }
 
-    // Try to connect
-    LOG_INFO("[MQTTHandler] Connecting to MQTT broker...");
-    client->connectToHost();
-    
-    // Test the connection after a delay
-    QTimer::singleShot(5000, this, [this, host, port, username, password]() {
-        if (client->state() == QMqttClient::Connected) {
-            LOG_INFO("[MQTTHandler] Connection successful to %s:%d.", 
-                     qUtf8Printable(host), port);
-        } else {
-            LOG_ERROR("[MQTTHandler] Not connected to %s:%d after 5 seconds", 
-                     qUtf8Printable(host), port);
-            
-            // Try Home Assistant default credentials as a fallback
-            LOG_INFO("[MQTTHandler] Trying fallback connection to core-mosquitto:1883");
-            client->disconnectFromHost();
-            client->setHostname("core-mosquitto");
-            client->setPort(1883);
-            client->setUsername("homeassistant");
-            client->setPassword("homeassistant");
-            client->connectToHost();
-            
-            QTimer::singleShot(3000, this, [this]() {
-                if (client->state() == QMqttClient::Connected) {
-                    LOG_INFO("[MQTTHandler] Fallback connection successful.");
-                } else {
-                    LOG_ERROR("[MQTTHandler] Fallback connection failed");
-                }
-            });
+    // A pooled connection that is down holds the topic back rather than handing it to another
+    // socket, where it could overtake or be overtaken by the topic's other publishes
+    if (shardFor(topic)->state() != QMqttClient::Connected) {
+        PublishOptions options;
+        options.qos = qos;
+        options.retain = retain;
+        enqueuePending(topic, payload, options);
+        if (!flushTimer->isActive()) {
+            flushTimer->start();
         }
-    });
-    
+        return false;
+    }
+
+    std::vector<MQTTConnection::Publish> batch;
+    batch.push_back({topic, payload, qos, retain});
+    sendBatch(std::move(batch));
     return true;
 }
 
-void MQTTHandler::disconnect()
+MQTTConnection* MQTTHandler::shardFor(const QString& topic) const
+{
+    // A topic always takes the same socket, so its publishes stay in order
+    if (connections.size() == 1) {
+        return connection;
+    }
+    return connections[qHash(topic) % connections.size()];
+}
+
+void MQTTHandler::sendBatch(std::vector<MQTTConnection::Publish>&& batch)
 {
-    if (client->state() != QMqttClient::Disconnected) {
-        LOG_INFO("MQTT: Disconnecting...");
-        if (!willTopic.isEmpty()) {
-            publish(willTopic, "offline");
+    // One cross-thread hop per batch rather than per message
+    if (connections.size() == 1) {
+        MQTTConnection* conn = connection;
+        QMetaObject::invokeMethod(connection, [conn, batch = std::move(batch)]() {
+            conn->publishBatch(batch);
+        }, Qt::QueuedConnection);
+        return;
+    }
+
+    // Shard by topic; callers hold back topics whose shard is down
+    std::vector<std::vector<MQTTConnection::Publish>> shards(connections.size());
+    for (MQTTConnection::Publish& message : batch) {
+        shards[qHash(message.topic) % connections.size()].push_back(std::move(message));
+    }
+
+    for (size_t i = 0; i < shards.size(); i++) {
+        if (shards[i].empty()) {
+            continue;
         }
-        client->disconnectFromHost();
+        MQTTConnection* conn = connections[i];
+        QMetaObject::invokeMethod(conn, [conn, shard_batch = std::move(shards[i])]() {
+            conn->publishBatch(shard_batch);
+        }, Qt::QueuedConnection);
     }
 }
 
-bool MQTTHandler::isConnected() const
+bool MQTTHandler::subscribe(const QString& topic, bool silent, quint8 qos)
 {
-    return client->state() == QMqttClient::Connected;
+    // Silence compiler warnings for unused parameter
+    (void)silent;
+
+    // The connection keeps the filter and restores it after every reconnect
+    MQTTConnection* conn = connection;
+    QMetaObject::invokeMethod(connection, [conn, topic, qos]() {
+        conn->subscribe(topic, qos);
+    }, Qt::QueuedConnection);
+    return isConnected();
 }
 
-bool MQTTHandler::publish(const QString& topic, const QByteArray& payload, quint8 qos, bool retain, bool silent)
+void MQTTHandler::addSubscription(const QString& filter, quint8 qos)
 {
-    if (client->state() != QMqttClient::Connected) {
-        LOG_WARNING("[MQTTHandler] Cannot publish when not connected. Topic: %s", qUtf8Printable(topic));
-        return false;
+    if (!subscriptionRegistry.acquire(filter)) {
+        return;
     }
 
-    // Silence compiler warnings for unused parameter
-    (void)silent;
+    // Re-acquired before the last release was flushed - nothing to tell the broker
+    if (pendingUnsubscribes.removeOne(filter)) {
+        return;
+    }
 
-    // Standard MQTT publish with requested QoS level
-    LOG_INFO("[MQTTHandler] Publishing to topic: %s, payload: %s", qUtf8Printable(topic), payload.constData());
-    qint32 result = client->publish(QMqttTopicName(topic), payload, qos, retain);
-    
-    if (result == -1) {
-        LOG_ERROR("[MQTTHandler] Failed to publish to topic: %s", qUtf8Printable(topic));
-        return false;
+    pendingSubscribes.insert(filter, qos);
+    if (!subscriptionFlushScheduled) {
+        subscriptionFlushScheduled = true;
+        QMetaObject::invokeMethod(this, &MQTTHandler::flushSubscriptionChanges, Qt::QueuedConnection);
     }
-    
-    LOG_INFO("[MQTTHandler] Successfully published to topic: %s", qUtf8Printable(topic));
-    return true;
 }
 
-bool MQTTHandler::subscribe(const QString& topic, bool silent, quint8 qos)
+void MQTTHandler::removeSubscription(const QString& filter)
 {
-    if (client->state() != QMqttClient::Connected) {
-        // Cannot subscribe when not connected
-        return false;
+    if (!subscriptionRegistry.release(filter)) {
+        return;
     }
 
-    // Silence compiler warnings for unused parameter
-    (void)silent;
+    // Released before the subscribe was flushed - it never has to go out
+    if (pendingSubscribes.remove(filter) > 0) {
+        return;
+    }
 
-    // Only print subscribe info when needed (parameter kept for API compatibility)
-    auto subscription = client->subscribe(QMqttTopicFilter(topic), qos);
-    if (!subscription) {
-        // Failed to subscribe
-        return false;
+    pendingUnsubscribes.append(filter);
+    if (!subscriptionFlushScheduled) {
+        subscriptionFlushScheduled = true;
+        QMetaObject::invokeMethod(this, &MQTTHandler::flushSubscriptionChanges, Qt::QueuedConnection);
     }
-    return true;
 }
 
-void MQTTHandler::handleMessage(const QByteArray& message, const QMqttTopicName& topic)
+void MQTTHandler::flushSubscriptionChanges()
 {
-    // Log every message received
-    LOG_INFO("[MQTTHandler] Received message on topic: %s", qUtf8Printable(topic.name()));
-    
-    QMutexLocker locker(&mutex);
-    messageQueue.enqueue(qMakePair(topic.name(), message));
+    subscriptionFlushScheduled = false;
+    if (pendingSubscribes.isEmpty() && pendingUnsubscribes.isEmpty()) {
+        return;
+    }
+
+    // Only the primary connection carries subscriptions
+    MQTTConnection* conn = connection;
+    QMap<QString, quint8> added = pendingSubscribes;
+    QStringList removed = pendingUnsubscribes;
+    pendingSubscribes.clear();
+    pendingUnsubscribes.clear();
+
+    QMetaObject::invokeMethod(connection, [conn, added, removed]() {
+        conn->updateSubscriptions(added, removed);
+    }, Qt::QueuedConnection);
 }
 
-void MQTTHandler::processMessageQueue()
+void MQTTHandler::setReconnectBackoff(int min_msec, int max_msec)
 {
-    QMutexLocker locker(&mutex);
-    
-    // Process up to 20 messages at once to clear backlogs efficiently
-    int processed = 0;
-    int max_messages = 20;
-    
-    while (!messageQueue.isEmpty() && processed < max_messages) {
-        auto msg = messageQueue.dequeue();
-        processed++;
-        
-        // Emit the message - unified approach for all message types
-        emit messageReceived(msg.first, msg.second);
+    invokeOnAll([min_msec, max_msec](MQTTConnection* conn) {
+        conn->setReconnectBackoff(min_msec, max_msec);
+    });
+}
+
+MQTTHandler::ConnectionStats MQTTHandler::connectionStats() const
+{
+    ConnectionStats stats;
+    stats.state = connection->linkState();
+    stats.recoveries = connection->recoveries();
+    stats.last_recovery_ms = connection->lastRecoveryMsec();
+    return stats;
+}
+
+void MQTTHandler::queuePublish(const QString& topic, const QByteArray& payload, const PublishOptions& options)
+{
+    if (options.origin_ns > 0) {
+        StageMetrics::record(StageMetrics::PublishEmit, Latency::nowNs() - options.origin_ns);
+    }
+
+    publishesQueued++;
+    if (enqueuePending(topic, payload, options)) {
+        publishesCoalesced++;
+    }
+
+    if (!flushTimer->isActive()) {
+        flushTimer->start();
+    }
+}
+
+void MQTTHandler::setPublishFlushInterval(int msec)
+{
+    flushTimer->setInterval(msec > 0 ? msec : 0);
+}
+
+void MQTTHandler::setRateLimits(const QJsonObject& limits)
+{
+    rateLimiter.configure(limits);
+}
+
+void MQTTHandler::setStreamingExpiry(int seconds)
+{
+    streamingExpirySec = seconds > 0 ? static_cast<quint32>(seconds) : 0;
+}
+
+void MQTTHandler::setReliability(quint8 final_qos, int max_in_flight)
+{
+    finalStateQos = qMin<quint8>(final_qos, 2);
+
+    invokeOnAll([max_in_flight](MQTTConnection* conn) {
+        conn->setInFlightWindow(max_in_flight);
+    });
+}
+
+void MQTTHandler::setBackpressureWatermarks(qint64 high_bytes, qint64 low_bytes)
+{
+    backpressureHighBytes = high_bytes > 0 ? high_bytes : 0;
+    backpressureLowBytes = qBound<qint64>(0, low_bytes, backpressureHighBytes);
+}
+
+qint64 MQTTHandler::transportBacklog() const
+{
+    qint64 backlog = 0;
+    for (const MQTTConnection* conn : connections) {
+        backlog += conn->transportBacklog();
+    }
+    return backlog;
+}
+
+void MQTTHandler::updateBackpressure()
+{
+    const qint64 backlog = backpressureHighBytes > 0 ? transportBacklog() : 0;
+
+    // Two watermarks so a backlog hovering around one doesn't flap the state
+    bool active = backpressured;
+    if (!backpressured && backpressureHighBytes > 0 && backlog > backpressureHighBytes) {
+        active = true;
+    } else if (backpressured && backlog <= backpressureLowBytes) {
+        active = false;
+    }
+
+    if (active != backpressured) {
+        backpressured = active;
+        TRACE_INFO("mqtt", active ? "backpressure_on" : "backpressure_off", backlog, pendingCount());
+        emit backpressureChanged(active);
+    }
+}
+
+void MQTTHandler::setOfflineBufferLimit(qint64 max_bytes)
+{
+    offlineMaxBytes = max_bytes > 0 ? max_bytes : 0;
+}
+
+void MQTTHandler::bufferOffline(const QString& topic, const QByteArray& payload, const PublishOptions& options)
+{
+    // One entry per topic, so memory follows the number of devices rather than time offline
+    const qint64 cost = static_cast<qint64>(topic.size()) * sizeof(QChar) + payload.size();
+    if (!offlineStates.contains(topic) && offlineStates.bytes() + cost > offlineMaxBytes) {
+        if (offlineDropped++ == 0) {
+            LOG_WARNING("[MQTTHandler] Offline buffer full, not holding state for: %s", qUtf8Printable(topic));
+        }
+        return;
+    }
+
+    // Whatever the frame was, it is now the state to restore, and replays ahead of new frames
+    offlineStates.enqueue(topic, payload, options.withDelivery(PublishOptions::Final).withLane(PublishOptions::ControlLane));
+}
+
+MQTTHandler::PublishStats MQTTHandler::publishStats() const
+{
+    PublishStats stats;
+    stats.queued = publishesQueued;
+    stats.coalesced = publishesCoalesced;
+    stats.deferred = publishesDeferred;
+    stats.sent = publishesSent;
+    stats.pending = 0;
+    for (int lane = 0; lane < PublishOptions::LANE_COUNT; lane++) {
+        stats.pending_by_lane[lane] = pendingLanes[lane].size();
+        stats.pending += stats.pending_by_lane[lane];
+    }
+    stats.aliased = 0;
+    stats.alias_bytes_saved = 0;
+    stats.in_flight = 0;
+    for (const MQTTConnection* conn : connections) {
+        stats.aliased += conn->aliasedPublishes();
+        stats.alias_bytes_saved += conn->aliasBytesSaved();
+        stats.in_flight += conn->inFlightCount();
     }
+    stats.offline_buffered = offlineStates.size();
+    stats.offline_dropped = offlineDropped;
+    stats.throttled = publishesThrottled;
+    stats.transport_backlog = transportBacklog();
+    return stats;
 }
 
-void MQTTHandler::handleStateChange()
+void MQTTHandler::flushPendingPublishes()
 {
-    switch(client->state()) {
-        case QMqttClient::Connected:
-            if (!willTopic.isEmpty()) {
-                publish(willTopic, "online");
+    // While offline nothing is spent on the rate limiter - pending states wait for the reconnect
+    if (!isConnected()) {
+        for (OutboundQueue& lane : pendingLanes) {
+            for (const OutboundQueue::Entry& entry : lane.takeAll()) {
+                bufferOffline(entry.topic, entry.payload, entry.options);
             }
-            emit connectionStatusChanged(true);
-            break;
-            
-        case QMqttClient::Disconnected:
-            emit connectionStatusChanged(false);
-            break;
-            
-        default:
-            break;
+        }
+        // The socket went with the link, so this releases paused devices
+        updateBackpressure();
+        return;
+    }
+
+    updateBackpressure();
+
+    const qint64 now_ms = rateClock.elapsed();
+    std::vector<MQTTConnection::Publish> batch;
+
+    // Strict priority: higher lanes take rate limit tokens first and go out ahead in the batch,
+    // so a control publish never waits behind a tick's worth of effect frames
+    for (OutboundQueue& lane : pendingLanes) {
+        for (const OutboundQueue::Entry& entry : lane.takeAll()) {
+            // Waits for its own pooled connection to come back, newer publishes replacing it
+            if (shardFor(entry.topic)->state() != QMqttClient::Connected) {
+                lane.enqueue(entry.topic, entry.payload, entry.options);
+                continue;
+            }
+
+            // A slow socket holds streaming frames here, where newer frames replace them, instead
+            // of letting them pile up unbounded in the socket buffer
+            if (backpressured && entry.options.delivery == PublishOptions::Streaming) {
+                lane.enqueue(entry.topic, entry.payload, entry.options);
+                publishesThrottled++;
+                continue;
+            }
+
+            if (!rateLimiter.tryAcquire(entry.topic, entry.options, now_ms)) {
+                // Over limit - stays pending so newer frames for the topic replace it
+                lane.enqueue(entry.topic, entry.payload, entry.options);
+                publishesDeferred++;
+                continue;
+            }
+
+            // Streaming frames expire; final states are acknowledged
+            const bool streaming = entry.options.delivery == PublishOptions::Streaming;
+            const quint32 expiry = streaming ? streamingExpirySec : 0;
+            const quint8 qos = streaming ? entry.options.qos : qMax(entry.options.qos, finalStateQos);
+            batch.push_back({entry.topic, entry.payload, qos, entry.options.retain, expiry, entry.options.topic_name,
+                             entry.options.origin_ns, entry.options.latency});
+        }
+    }
+
+    const int pending = pendingCount();
+    TRACE_DEBUG("mqtt", "flush", batch.size(), pending);
+
+    if (!batch.empty()) {
+        publishesSent += batch.size();
+        sendBatch(std::move(batch));
+    }
+
+    // Nothing else re-checks the backlog, so keep ticking until it drains even with nothing pending
+    if (pending > 0 || backpressured) {
+        flushTimer->start();
     }
 }
 
-void MQTTHandler::handleError()
+bool MQTTHandler::enqueuePending(const QString& topic, const QByteArray& payload, const PublishOptions& options)
 {
-    QString errorMsg;
-    auto error = client->error();
-    switch (error) {
-        case QMqttClient::NoError:
-            return;
-        case QMqttClient::InvalidProtocolVersion:
-            errorMsg = "Invalid protocol version";
-            break;
-        case QMqttClient::IdRejected:
-            errorMsg = "Client ID rejected";
-            break;
-        case QMqttClient::ServerUnavailable:
-            errorMsg = "Server unavailable";
-            break;
-        case QMqttClient::BadUsernameOrPassword:
-            errorMsg = "Bad username or password";
-            break;
-        case QMqttClient::NotAuthorized:
-            errorMsg = "Not authorized";
-            break;
-        case QMqttClient::TransportInvalid:
-            errorMsg = "Network error";
-            break;
-        default:
-            errorMsg = QString("Unknown error: %1").arg(static_cast<int>(error));
+    // A device's effect frames and its final state share the command topic but not the lane.
+    // Left in both, the older one could go out after the newer and overwrite it.
+    bool replaced = false;
+    for (int lane = 0; lane < PublishOptions::LANE_COUNT; lane++) {
+        if (lane != options.lane && pendingLanes[lane].remove(topic)) {
+            replaced = true;
+        }
+    }
+    return pendingLanes[options.lane].enqueue(topic, payload, options) || replaced;
+}
+
+int MQTTHandler::pendingCount() const
+{
+    int pending = 0;
+    for (const OutboundQueue& lane : pendingLanes) {
+        pending += lane.size();
+    }
+    return pending;
+}
+
+void MQTTHandler::setQueueLimits(qint64 max_bytes, OverflowPolicy policy)
+{
+    maxQueuedBytes.store(max_bytes > 0 ? max_bytes : 0);
+    overflowPolicy.store(policy);
+
+    // Every message costs at least MESSAGE_OVERHEAD, so with twice the cap in slots the byte
+    // cap binds first - DropOldest accepts past the cap until the consumer trims
+    if (connection && connection->linkState() != MQTTConnection::Idle) {
+        LOG_WARNING("[MQTTHandler] Queue limits changed while connected, keeping the current ring size");
+        return;
+    }
+    const qint64 wanted = max_bytes > 0 ? 2 * max_bytes / MESSAGE_OVERHEAD : RING_SLOTS_UNCAPPED;
+    messageQueue.reset(static_cast<size_t>(qBound<qint64>(RING_SLOTS_MIN, wanted, RING_SLOTS_MAX)));
+}
+
+void MQTTHandler::setDrainBudget(int budget_usec)
+{
+    drainBudgetUsec = budget_usec > 0 ? budget_usec : 1;
+}
+
+MQTTHandler::QueueStats MQTTHandler::queueStats() const
+{
+    QueueStats stats;
+    stats.received = receivedMessages.load();
+    stats.depth = messageQueue.size();
+    stats.high_water = highWaterMark.load();
+    stats.dropped = droppedMessages.load();
+    stats.queued_bytes = queuedBytes.load();
+    return stats;
+}
+
+qint64 MQTTHandler::messageCost(const QString& topic, const QByteArray& payload)
+{
+    return static_cast<qint64>(topic.size()) * sizeof(QChar) + payload.size()
+         + MESSAGE_OVERHEAD;
+}
+
+void MQTTHandler::handleMessage(const QByteArray& message, const QMqttTopicName& topic)
+{
+    StageMetrics::ScopedTimer timer(StageMetrics::Ingress);
+    receivedMessages.fetch_add(1, std::memory_order_relaxed);
+
+    const QString name = topic.name();
+    const qint64 cost = messageCost(name, message);
+    const qint64 cap = maxQueuedBytes.load();
+
+    // DropNewest refuses anything past the cap; DropOldest lets the consumer trim instead
+    bool accepted = false;
+    if (cap == 0 || overflowPolicy.load() == DropOldest || queuedBytes.load() + cost <= cap) {
+        queuedBytes += cost;
+        accepted = messageQueue.push({name, message, topicTable.intern(name), Latency::nowNs()});
+        if (!accepted) {
+            queuedBytes -= cost;
+        }
+    }
+
+    if (!accepted) {
+        TRACE_ERROR("mqtt", "ingress_dropped", message.size(), messageQueue.size());
+        quint64 dropped = ++droppedMessages;
+        if (!overflowLogged.exchange(true)) {
+            LOG_WARNING("[MQTTHandler] Inbound queue full, dropping messages (first: %s, total dropped: %llu)",
+                        qUtf8Printable(name), static_cast<unsigned long long>(dropped));
+        }
+        return;
+    }
+
+    quint64 depth = messageQueue.size();
+    TRACE_INFO("mqtt", "ingress", message.size(), depth);
+
+    quint64 high_water = highWaterMark.load();
+    while (depth > high_water && !highWaterMark.compare_exchange_weak(high_water, depth)) {
+    }
+
+    scheduleDrain();
+}
+
+void MQTTHandler::scheduleDrain()
+{
+    // Only one drain is ever pending - an idle queue costs no wakeups
+    if (!drainScheduled.exchange(true)) {
+        QMetaObject::invokeMethod(this, &MQTTHandler::processMessageQueue, Qt::QueuedConnection);
+    }
+}
+
+void MQTTHandler::discardOldest()
+{
+    const qint64 cap = maxQueuedBytes.load();
+    if (cap == 0) {
+        return;
+    }
+
+    MessageRingBuffer::Message msg;
+    quint64 discarded = 0;
+    while (queuedBytes.load() > cap && messageQueue.pop(msg)) {
+        queuedBytes -= messageCost(msg.topic, msg.payload);
+        discarded++;
+    }
+
+    if (discarded > 0) {
+        quint64 dropped = (droppedMessages += discarded);
+        if (!overflowLogged.exchange(true)) {
+            LOG_WARNING("[MQTTHandler] Inbound queue over memory cap, discarded oldest messages (total dropped: %llu)",
+                        static_cast<unsigned long long>(dropped));
+        }
+    }
+}
+
+void MQTTHandler::processMessageQueue()
+{
+    // Clear the flag before draining so a message pushed mid-drain schedules a new pass
+    drainScheduled.store(false);
+
+    if (overflowPolicy.load() == DropOldest) {
+        discardOldest();
+    }
+
+    // Dispatch until the time budget for this slice is spent, then yield to the event loop
+    QElapsedTimer slice;
+    slice.start();
+    const qint64 budget_nsec = static_cast<qint64>(drainBudgetUsec) * 1000;
+
+    MessageRingBuffer::Message msg;
+    [[maybe_unused]] quint64 processed = 0;     // Only read by TRACE_DEBUG
+    while (messageQueue.pop(msg)) {
+        queuedBytes -= messageCost(msg.topic, msg.payload);
+        processed++;
+        StageMetrics::record(StageMetrics::QueueWait, Latency::nowNs() - msg.enqueued_ns);
+
+        // Emit the message - unified approach for all message types
+        emit messageReceived(msg.topic_id, msg.topic, msg.payload);
+
+        if (slice.nsecsElapsed() >= budget_nsec) {
             break;
+        }
     }
-    
-    LOG_ERROR("MQTT Error: %s", qUtf8Printable(errorMsg));
-    lastError = errorMsg;
-    emit connectionError(errorMsg);
-}
\ No newline at end of file
+
+    TRACE_DEBUG("mqtt", "drain", processed, messageQueue.size());
+
+    if (!messageQueue.isEmpty()) {
+        scheduleDrain();
+    } else {
+        // Backlog cleared - report the next overflow episode again
+        overflowLogged.store(false);
+    }
+}
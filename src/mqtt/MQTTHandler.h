@@ -2,20 +2,92 @@
 
 #include <QObject>
 #include <QtMqtt/qmqttclient.h>
-#include <QMutex>
-#include <QQueue>
-#include <QPair>
+#include <QThread>
 #include <QTimer>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <atomic>
+#include <functional>
+#include <vector>
+#include "MQTTConnection.h"
+#include "MessageRingBuffer.h"
+#include "OutboundQueue.h"
+#include "PublishOptions.h"
+#include "PublishRateLimiter.h"
+#include "SubscriptionRegistry.h"
+#include "TopicTable.h"
+
+/*---------------------------------------------------------*\
+| MQTTHandler                                               |
+|                                                           |
+| GUI-thread facade for the MQTT bridge. The QMqttClient    |
+| runs inside an MQTTConnection on a dedicated network      |
+| thread; calls below never block on broker I/O. Inbound    |
+| messages cross back through a lock-free ring buffer and   |
+| are emitted from messageReceived on this object's thread. |
+|                                                           |
+| Optionally publishes are spread over a pool of broker     |
+| connections, each on its own thread. A topic always maps  |
+| to the same connection so its ordering is kept. The first |
+| connection is the primary: it owns subscriptions, inbound |
+| traffic and the connection status reported to the UI.    |
+\*---------------------------------------------------------*/
 
 class MQTTHandler : public QObject
 {
     Q_OBJECT
 
 public:
+    // What to do when the inbound queue reaches its memory cap
+    enum OverflowPolicy {
+        DropNewest,     // Reject incoming messages until the backlog drains
+        DropOldest      // Accept incoming messages, discard the oldest queued ones
+    };
+
+    struct QueueStats {
+        quint64 received;       // Inbound messages seen since startup, queued or not
+        quint64 depth;          // Messages currently queued
+        quint64 high_water;     // Deepest the queue has been since startup
+        quint64 dropped;        // Messages discarded by the overflow policy
+        qint64  queued_bytes;   // Approximate memory held by queued messages
+    };
+
+    struct ConnectionStats {
+        MQTTConnection::LinkState state;
+        quint64 recoveries;     // Reconnects after an unplanned disconnect
+        qint64  last_recovery_ms;   // Outage length of the latest recovery, -1 if none yet
+    };
+
+    struct PublishStats {
+        quint64 queued;         // Publishes handed to queuePublish
+        quint64 coalesced;      // Replaced by a newer payload before reaching the socket
+        quint64 deferred;       // Held back by the rate limiter for a later tick
+        quint64 sent;           // Actually handed to the MQTT client
+        int     pending;        // Topics waiting for the next flush tick
+        int     pending_by_lane[PublishOptions::LANE_COUNT];
+        quint64 aliased;        // Sent under an MQTT 5 topic alias
+        qint64  alias_bytes_saved;  // Topic bytes kept off the wire by aliasing
+        int     in_flight;      // QoS 1+ publishes awaiting acknowledgement
+        int     offline_buffered;   // Topics holding a last state for the next connection
+        quint64 offline_dropped;    // Topics turned away because the offline buffer was full
+        quint64 throttled;      // Streaming frames held back while the transport was backpressured
+        qint64  transport_backlog;  // Bytes the sockets still have to send
+    };
+
     explicit MQTTHandler(QObject* parent = nullptr);
     ~MQTTHandler();
 
     void setWillMessage(const QString& topic, const QString& message);
+
+    // Number of broker connections publishes are sharded across - set before connecting
+    void setConnectionPoolSize(int size);
+
+    // Protocol for the next connection; topic_alias_limit caps MQTT 5 aliases (0 disables)
+    void setProtocol(QMqttClient::ProtocolVersion version, quint16 topic_alias_limit);
+
+    // Session for the next connection; a persistent one keeps subscriptions across reconnects
+    void setSession(const QString& client_id, bool persistent, quint32 expiry_sec);
+
     bool connectToHost(const QString& host, quint16 port,
                       const QString& username = QString(),
                       const QString& password = QString());
@@ -24,23 +96,133 @@ public:
     bool publish(const QString& topic, const QByteArray& payload, quint8 qos = 0, bool retain = false, bool silent = false);
     bool subscribe(const QString& topic, bool silent = false, quint8 qos = 0);
 
+    // Reference-counted subscriptions for the protocol managers; changes made
+    // in one event loop turn reach the network thread together
+    void addSubscription(const QString& filter, quint8 qos = 0);
+    void removeSubscription(const QString& filter);
+
+    // Reconnect backoff bounds and metrics
+    void setReconnectBackoff(int min_msec, int max_msec);
+    ConnectionStats connectionStats() const;
+
+    // Inbound queue tuning and metrics. max_bytes is the limit the policy acts on; the
+    // ring behind it is sized so its slots only run out if the GUI thread stalls for
+    // twice that much traffic, and then the newest message is dropped whatever the
+    // policy. With max_bytes 0 the ring's slot count is the only limit. Resizes the
+    // ring, so call it before connecting.
+    void setQueueLimits(qint64 max_bytes, OverflowPolicy policy);
+    void setDrainBudget(int budget_usec);
+    QueueStats queueStats() const;
+
+    // Outbound publishes that only need the latest value per topic
+    void queuePublish(const QString& topic, const QByteArray& payload, const PublishOptions& options = PublishOptions());
+    void setPublishFlushInterval(int msec);
+    void setRateLimits(const QJsonObject& limits);
+    void setStreamingExpiry(int seconds);
+
+    // Memory cap for last states held while disconnected, 0 disables buffering
+    void setOfflineBufferLimit(qint64 max_bytes);
+
+    // Final-state publishes go out at least at final_qos, at most max_in_flight unacknowledged
+    void setReliability(quint8 final_qos, int max_in_flight);
+    PublishStats publishStats() const;
+
+    // Streaming frames are held, and merged per topic, once the sockets hold more than
+    // high_bytes unsent, until they drain below low_bytes. high_bytes 0 disables.
+    void setBackpressureWatermarks(qint64 high_bytes, qint64 low_bytes);
+    bool isBackpressured() const { return backpressured; }
+
 signals:
-    void messageReceived(const QString& topic, const QByteArray& payload);
+    void messageReceived(TopicId topic_id, const QString& topic, const QByteArray& payload);
     void connectionStatusChanged(bool connected);
     void connectionError(const QString& error);
 
+    // Back after an unplanned disconnect - subscriptions restored, device state should be resent
+    void connectionRecovered(qint64 outage_msec);
+
+    // The transport crossed a watermark - DeviceManager pauses effect frames while active
+    void backpressureChanged(bool active);
+
 private slots:
+    // Runs on the network thread
     void handleMessage(const QByteArray& message, const QMqttTopicName& topic);
-    void handleStateChange();
-    void handleError();
+
+    // Run on the GUI thread
+    void handleConnected();
+    void handleDisconnected();
     void processMessageQueue();
+    void flushPendingPublishes();
+    void flushSubscriptionChanges();
 
 private:
-    QMqttClient* client;
+    // connections[i] lives on networkThreads[i]; connection is the primary, connections[0]
+    std::vector<QThread*> networkThreads;
+    std::vector<MQTTConnection*> connections;
+    MQTTConnection* connection;
     QString willTopic;
     QString willMessage;
     QString lastError;
-    mutable QMutex mutex;
-    QQueue<QPair<QString, QByteArray>> messageQueue;
-    QTimer* processTimer;
+
+    // Inbound messages - filled by handleMessage, drained by processMessageQueue
+    TopicTable topicTable;
+    MessageRingBuffer messageQueue;
+    std::atomic<bool> drainScheduled;
+    std::atomic<quint64> receivedMessages;
+    std::atomic<quint64> droppedMessages;
+    std::atomic<quint64> highWaterMark;
+    std::atomic<qint64> queuedBytes;
+    std::atomic<qint64> maxQueuedBytes;
+    std::atomic<int> overflowPolicy;
+    std::atomic<bool> overflowLogged;
+    int drainBudgetUsec;
+
+    // Outbound publishes waiting for the next flush tick, one queue per PublishOptions::Lane.
+    // A topic is pending in at most one lane, the one its latest publish asked for.
+    OutboundQueue pendingLanes[PublishOptions::LANE_COUNT];
+    QTimer* flushTimer;
+    quint64 publishesQueued;
+    quint64 publishesCoalesced;
+    quint64 publishesDeferred;
+    quint64 publishesSent;
+
+    // Token buckets applied at flush time
+    PublishRateLimiter rateLimiter;
+    QElapsedTimer rateClock;
+
+    // Message Expiry Interval given to streaming publishes under MQTT 5
+    quint32 streamingExpirySec;
+
+    // Minimum QoS for final-state publishes
+    quint8 finalStateQos;
+
+    // Last intended state per topic while disconnected - replayed on reconnect
+    OutboundQueue offlineStates;
+    qint64 offlineMaxBytes;
+    quint64 offlineDropped;
+
+    // Transport backpressure, evaluated on every flush tick
+    qint64 backpressureHighBytes;
+    qint64 backpressureLowBytes;
+    bool backpressured;
+    quint64 publishesThrottled;
+
+    // Subscription changes waiting for the end of the event loop turn
+    SubscriptionRegistry subscriptionRegistry;
+    QMap<QString, quint8> pendingSubscribes;
+    QStringList pendingUnsubscribes;
+    bool subscriptionFlushScheduled;
+
+    void bufferOffline(const QString& topic, const QByteArray& payload, const PublishOptions& options);
+    bool enqueuePending(const QString& topic, const QByteArray& payload, const PublishOptions& options);
+    int pendingCount() const;
+    MQTTConnection* shardFor(const QString& topic) const;
+    qint64 transportBacklog() const;
+    void updateBackpressure();
+
+    MQTTConnection* startConnection();
+    void invokeOnAll(const std::function<void(MQTTConnection*)>& call);
+    void sendBatch(std::vector<MQTTConnection::Publish>&& batch);
+    void scheduleDrain();
+    void discardOldest();
+    static qint64 messageCost(const QString& topic, const QByteArray& payload);
 };
\ No newline at end of file
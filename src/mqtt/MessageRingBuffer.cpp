@@ -0,0 +1,70 @@
+#include "MessageRingBuffer.h"
+#include <utility>
+
+static size_t roundUpToPowerOfTwo(size_t value)
+{
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+MessageRingBuffer::MessageRingBuffer(size_t capacity)
+    : buffer(roundUpToPowerOfTwo(capacity < 2 ? 2 : capacity))
+    , mask(buffer.size() - 1)
+    , head(0)
+    , tail(0)
+{
+}
+
+void MessageRingBuffer::reset(size_t capacity)
+{
+    buffer = std::vector<Message>(roundUpToPowerOfTwo(capacity < 2 ? 2 : capacity));
+    mask = buffer.size() - 1;
+    head.store(0);
+    tail.store(0);
+}
+
+bool MessageRingBuffer::push(Message&& message)
+{
+    const size_t current_head = head.load(std::memory_order_relaxed);
+    const size_t current_tail = tail.load(std::memory_order_acquire);
+
+    if (current_head - current_tail >= buffer.size()) {
+        return false;
+    }
+
+    buffer[current_head & mask] = std::move(message);
+    head.store(current_head + 1, std::memory_order_release);
+    return true;
+}
+
+bool MessageRingBuffer::pop(Message& message)
+{
+    const size_t current_tail = tail.load(std::memory_order_relaxed);
+    const size_t current_head = head.load(std::memory_order_acquire);
+
+    if (current_tail == current_head) {
+        return false;
+    }
+
+    // Move out and leave the slot empty so payload memory is released right away
+    Message& slot = buffer[current_tail & mask];
+    message = std::move(slot);
+    slot = Message();
+    tail.store(current_tail + 1, std::memory_order_release);
+    return true;
+}
+
+bool MessageRingBuffer::isEmpty() const
+{
+    return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+}
+
+size_t MessageRingBuffer::size() const
+{
+    const size_t current_tail = tail.load(std::memory_order_acquire);
+    const size_t current_head = head.load(std::memory_order_acquire);
+    return current_head - current_tail;
+}
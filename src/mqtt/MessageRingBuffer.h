@@ -0,0 +1,51 @@
+#pragma once
+
+#include <QString>
+#include <QByteArray>
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include "TopicTable.h"
+
+/*---------------------------------------------------------*\
+| MessageRingBuffer                                         |
+|                                                           |
+| Bounded single-producer/single-consumer queue for inbound |
+| MQTT messages. The producer is the MQTT client callback,  |
+| the consumer is the dispatch slot. No locks are taken on  |
+| either side; capacity is rounded up to a power of two.    |
+\*---------------------------------------------------------*/
+
+class MessageRingBuffer
+{
+public:
+    struct Message {
+        QString topic;
+        QByteArray payload;
+        TopicId topic_id;
+        qint64 enqueued_ns;     // Latency::nowNs() at push, for the queue wait histogram
+    };
+
+    explicit MessageRingBuffer(size_t capacity = 4096);
+
+    // Drops anything queued and changes the capacity - only while neither side is running
+    void reset(size_t capacity);
+
+    // Producer side - returns false if the buffer is full
+    bool push(Message&& message);
+
+    // Consumer side - returns false if the buffer is empty
+    bool pop(Message& message);
+
+    bool isEmpty() const;
+    size_t size() const;
+    size_t capacity() const { return buffer.size(); }
+
+private:
+    std::vector<Message> buffer;
+    size_t mask;
+
+    // Keep the indices on separate cache lines so the two threads don't contend
+    alignas(64) std::atomic<size_t> head;  // Next slot to write (producer owned)
+    alignas(64) std::atomic<size_t> tail;  // Next slot to read (consumer owned)
+};
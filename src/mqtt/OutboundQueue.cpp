@@ -0,0 +1,47 @@
+#include "OutboundQueue.h"
+#include <utility>
+
+bool OutboundQueue::enqueue(const QString& topic, const QByteArray& payload, const PublishOptions& options)
+{
+    auto it = index.constFind(topic);
+    if (it != index.constEnd()) {
+        Entry& entry = entries[it.value()];
+        totalBytes += payload.size() - entry.payload.size();
+        entry.payload = payload;
+        entry.options = options;
+        return true;
+    }
+
+    index.insert(topic, static_cast<int>(entries.size()));
+    entries.push_back({topic, payload, options});
+    totalBytes += static_cast<qint64>(topic.size()) * sizeof(QChar) + payload.size();
+    return false;
+}
+
+bool OutboundQueue::remove(const QString& topic)
+{
+    auto it = index.find(topic);
+    if (it == index.end()) {
+        return false;
+    }
+
+    const int position = it.value();
+    index.erase(it);
+    totalBytes -= static_cast<qint64>(topic.size()) * sizeof(QChar) + entries[position].payload.size();
+    entries.erase(entries.begin() + position);
+
+    // Keep first-queued order - the entries behind it move up one
+    for (int i = position; i < static_cast<int>(entries.size()); i++) {
+        index[entries[i].topic] = i;
+    }
+    return true;
+}
+
+std::vector<OutboundQueue::Entry> OutboundQueue::takeAll()
+{
+    std::vector<Entry> taken;
+    taken.swap(entries);
+    index.clear();
+    totalBytes = 0;
+    return taken;
+}
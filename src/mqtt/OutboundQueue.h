@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <vector>
+#include "PublishOptions.h"
+
+/*---------------------------------------------------------*\
+| OutboundQueue                                             |
+|                                                           |
+| Pending outbound publishes keyed by topic. A newer        |
+| payload for a topic that is still waiting replaces the    |
+| older one in place, so only the latest frame per topic    |
+| reaches the socket. Entries leave in first-queued order.  |
+\*---------------------------------------------------------*/
+
+class OutboundQueue
+{
+public:
+    struct Entry {
+        QString topic;
+        QByteArray payload;
+        PublishOptions options;
+    };
+
+    // Returns true if the publish replaced one that was already pending
+    bool enqueue(const QString& topic, const QByteArray& payload, const PublishOptions& options);
+
+    // Drops the pending publish for topic, returns true if there was one
+    bool remove(const QString& topic);
+
+    // Hands over every pending entry and leaves the queue empty
+    std::vector<Entry> takeAll();
+
+    bool isEmpty() const { return entries.empty(); }
+    int size() const { return static_cast<int>(entries.size()); }
+    bool contains(const QString& topic) const { return index.contains(topic); }
+
+    // Approximate memory held by the pending topics and payloads
+    qint64 bytes() const { return totalBytes; }
+
+private:
+    std::vector<Entry> entries;
+    QHash<QString, int> index;      // topic -> position in entries
+    qint64 totalBytes = 0;
+};
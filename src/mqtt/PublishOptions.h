@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QString>
+#include <QMetaType>
+#include <QtMqtt/qmqtttopicname.h>
+
+class LatencyHistogram;
+
+/*---------------------------------------------------------*\
+| PublishOptions                                            |
+|                                                           |
+| Metadata carried with every mqttPublishNeeded emission so |
+| the outbound path can tell where a publish came from and  |
+| how it should be delivered.                               |
+\*---------------------------------------------------------*/
+
+struct PublishOptions
+{
+    enum Delivery {
+        Final,          // A state that must arrive, however late
+        Streaming       // One frame of an effect - worthless once a newer frame exists
+    };
+
+    // Outbound lanes, flushed in this order every tick
+    enum Lane {
+        ControlLane,    // Final states, commands and availability
+        DiscoveryLane,  // Discovery requests and announcements
+        StreamingLane,  // Effect frames - whatever is left after the lanes above
+        LANE_COUNT
+    };
+
+    QString device_class;   // Device class name, selects the per-device rate limit
+    QString protocol;       // Protocol name, selects the per-protocol rate limit
+    quint8 qos = 0;
+    bool retain = false;
+    Delivery delivery = Final;
+    Lane lane = ControlLane;
+
+    // Pre-validated topic built once by the device; empty means build one per publish
+    QMqttTopicName topic_name;
+
+    // Frame latency tracking - set per frame by the device, see Latency in utils/LatencyHistogram.h
+    qint64 origin_ns = 0;               // Latency::nowNs() when the frame was produced, 0 if untracked
+    LatencyHistogram* latency = nullptr;
+
+    PublishOptions withDelivery(Delivery mode) const
+    {
+        PublishOptions options = *this;
+        options.delivery = mode;
+        return options;
+    }
+
+    PublishOptions withLane(Lane priority) const
+    {
+        PublishOptions options = *this;
+        options.lane = priority;
+        return options;
+    }
+};
+
+Q_DECLARE_METATYPE(PublishOptions)
@@ -0,0 +1,102 @@
+#include "PublishRateLimiter.h"
+#include <QJsonValue>
+#include <algorithm>
+
+void PublishRateLimiter::TokenBucket::configure(const Limit& limit, qint64 now_ms)
+{
+    rate = limit.rate;
+    burst = std::max(1.0, limit.burst);
+    tokens = burst;
+    last_refill_ms = now_ms;
+}
+
+bool PublishRateLimiter::TokenBucket::available(qint64 now_ms)
+{
+    if (isUnlimited()) {
+        return true;
+    }
+
+    if (now_ms > last_refill_ms) {
+        tokens = std::min(burst, tokens + (now_ms - last_refill_ms) * rate / 1000.0);
+        last_refill_ms = now_ms;
+    }
+    return tokens >= 1.0;
+}
+
+PublishRateLimiter::Limit PublishRateLimiter::parseLimit(const QJsonValue& value)
+{
+    QJsonObject obj = value.toObject();
+    Limit limit;
+    limit.rate = obj["rate"].toDouble(0.0);
+    limit.burst = obj["burst"].toDouble(limit.rate);
+    return limit;
+}
+
+void PublishRateLimiter::configure(const QJsonObject& limits)
+{
+    global_limit = parseLimit(limits["global"]);
+
+    protocol_limits.clear();
+    QJsonObject protocols = limits["protocols"].toObject();
+    for (auto it = protocols.constBegin(); it != protocols.constEnd(); ++it) {
+        protocol_limits.insert(it.key(), parseLimit(it.value()));
+    }
+
+    device_class_limits.clear();
+    QJsonObject device_classes = limits["device_classes"].toObject();
+    for (auto it = device_classes.constBegin(); it != device_classes.constEnd(); ++it) {
+        device_class_limits.insert(it.key(), parseLimit(it.value()));
+    }
+
+    // Buckets are rebuilt lazily with the new limits
+    global_bucket.configure(global_limit, 0);
+    protocol_buckets.clear();
+    device_buckets.clear();
+}
+
+bool PublishRateLimiter::tryAcquire(const QString& topic, const PublishOptions& options, qint64 now_ms)
+{
+    TokenBucket* device_bucket = nullptr;
+    auto class_it = device_class_limits.constFind(options.device_class);
+    if (class_it != device_class_limits.constEnd() && class_it.value().rate > 0.0) {
+        auto it = device_buckets.find(topic);
+        if (it == device_buckets.end()) {
+            it = device_buckets.insert(topic, TokenBucket());
+            it.value().configure(class_it.value(), now_ms);
+        }
+        device_bucket = &it.value();
+    }
+
+    TokenBucket* protocol_bucket = nullptr;
+    auto protocol_it = protocol_limits.constFind(options.protocol);
+    if (protocol_it != protocol_limits.constEnd() && protocol_it.value().rate > 0.0) {
+        auto it = protocol_buckets.find(options.protocol);
+        if (it == protocol_buckets.end()) {
+            it = protocol_buckets.insert(options.protocol, TokenBucket());
+            it.value().configure(protocol_it.value(), now_ms);
+        }
+        protocol_bucket = &it.value();
+    }
+
+    // All levels must have a token before any of them is spent
+    if (device_bucket && !device_bucket->available(now_ms)) {
+        return false;
+    }
+    if (protocol_bucket && !protocol_bucket->available(now_ms)) {
+        return false;
+    }
+    if (!global_bucket.available(now_ms)) {
+        return false;
+    }
+
+    if (device_bucket) {
+        device_bucket->consume();
+    }
+    if (protocol_bucket) {
+        protocol_bucket->consume();
+    }
+    if (!global_bucket.isUnlimited()) {
+        global_bucket.consume();
+    }
+    return true;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QString>
+#include <QHash>
+#include <QJsonObject>
+#include "PublishOptions.h"
+
+/*---------------------------------------------------------*\
+| PublishRateLimiter                                        |
+|                                                           |
+| Hierarchical token buckets in front of the MQTT client.   |
+| A publish needs a token from its device bucket (rate set  |
+| per device class), its protocol bucket and the global     |
+| bucket. A rate of 0 disables that level.                  |
+\*---------------------------------------------------------*/
+
+class PublishRateLimiter
+{
+public:
+    struct Limit {
+        double rate = 0.0;      // Messages per second, 0 = unlimited
+        double burst = 0.0;     // Bucket depth in messages
+    };
+
+    // Reads {"global": {...}, "protocols": {...}, "device_classes": {...}}
+    void configure(const QJsonObject& limits);
+
+    // Takes a token from every level the publish belongs to, or none at all
+    bool tryAcquire(const QString& topic, const PublishOptions& options, qint64 now_ms);
+
+private:
+    class TokenBucket
+    {
+    public:
+        void configure(const Limit& limit, qint64 now_ms);
+        bool isUnlimited() const { return rate <= 0.0; }
+        bool available(qint64 now_ms);
+        void consume() { tokens -= 1.0; }
+
+    private:
+        double rate = 0.0;
+        double burst = 0.0;
+        double tokens = 0.0;
+        qint64 last_refill_ms = 0;
+    };
+
+    static Limit parseLimit(const QJsonValue& value);
+
+    Limit global_limit;
+    QHash<QString, Limit> protocol_limits;
+    QHash<QString, Limit> device_class_limits;
+
+    TokenBucket global_bucket;
+    QHash<QString, TokenBucket> protocol_buckets;
+    QHash<QString, TokenBucket> device_buckets;     // Keyed by command topic
+};
@@ -0,0 +1,21 @@
+#include "SubscriptionRegistry.h"
+
+bool SubscriptionRegistry::acquire(const QString& filter)
+{
+    return ++counts[filter] == 1;
+}
+
+bool SubscriptionRegistry::release(const QString& filter)
+{
+    auto it = counts.find(filter);
+    if (it == counts.end()) {
+        return false;
+    }
+
+    if (--it.value() > 0) {
+        return false;
+    }
+
+    counts.erase(it);
+    return true;
+}
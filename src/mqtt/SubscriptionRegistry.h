@@ -0,0 +1,30 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+
+/*---------------------------------------------------------*\
+| SubscriptionRegistry                                      |
+|                                                           |
+| Reference counts topic filters requested by the protocol  |
+| managers. Only the first acquire and the last release of  |
+| a filter need to reach the broker, so several managers or |
+| devices can share a filter without tracking each other.   |
+\*---------------------------------------------------------*/
+
+class SubscriptionRegistry
+{
+public:
+    // Returns true on the first reference - the filter has to be subscribed
+    bool acquire(const QString& filter);
+
+    // Returns true when the last reference goes - the filter has to be unsubscribed
+    bool release(const QString& filter);
+
+    int refCount(const QString& filter) const { return counts.value(filter); }
+    QStringList filters() const { return counts.keys(); }
+
+private:
+    QHash<QString, int> counts;
+};
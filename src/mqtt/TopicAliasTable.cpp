@@ -0,0 +1,80 @@
+#include "TopicAliasTable.h"
+
+namespace
+{
+    const quint32 PROMOTE_HITS = 3;         // Publishes before a topic is worth an alias
+    const quint32 DECAY_INTERVAL = 4096;    // Lookups between halving the hit counts
+}
+
+void TopicAliasTable::reset(quint16 maximum)
+{
+    alias_topics.assign(maximum, QString());
+    aliases.clear();
+    hits.clear();
+    lookups = 0;
+}
+
+quint16 TopicAliasTable::aliasFor(const QString& topic, bool& remapped)
+{
+    remapped = false;
+    if (alias_topics.empty()) {
+        return 0;
+    }
+
+    if (++lookups >= DECAY_INTERVAL) {
+        decay();
+    }
+
+    const quint32 count = ++hits[topic];
+
+    auto it = aliases.constFind(topic);
+    if (it != aliases.constEnd()) {
+        return it.value();
+    }
+
+    if (count < PROMOTE_HITS) {
+        return 0;
+    }
+
+    // Aliases are only ever reassigned, never released, so the next free one is size + 1
+    quint16 alias = 0;
+    if (static_cast<size_t>(aliases.size()) < alias_topics.size()) {
+        alias = static_cast<quint16>(aliases.size() + 1);
+    } else {
+        // Take over the coldest alias, with some hysteresis so two topics don't keep swapping
+        quint32 coldest_hits = 0;
+        for (size_t i = 0; i < alias_topics.size(); i++) {
+            const quint32 slot_hits = hits.value(alias_topics[i]);
+            if (alias == 0 || slot_hits < coldest_hits) {
+                alias = static_cast<quint16>(i + 1);
+                coldest_hits = slot_hits;
+            }
+        }
+
+        if (count <= coldest_hits * 2) {
+            return 0;
+        }
+
+        aliases.remove(alias_topics[alias - 1]);
+    }
+
+    alias_topics[alias - 1] = topic;
+    aliases.insert(topic, alias);
+    remapped = true;
+    return alias;
+}
+
+void TopicAliasTable::decay()
+{
+    lookups = 0;
+
+    // Halve every count and forget topics that have gone quiet, keeping aliased ones
+    for (auto it = hits.begin(); it != hits.end();) {
+        it.value() /= 2;
+        if (it.value() == 0 && !aliases.contains(it.key())) {
+            it = hits.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
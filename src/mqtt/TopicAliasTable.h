@@ -0,0 +1,39 @@
+#pragma once
+
+#include <QString>
+#include <QHash>
+#include <vector>
+
+/*---------------------------------------------------------*\
+| TopicAliasTable                                           |
+|                                                           |
+| Assigns MQTT 5 topic aliases to the most frequently       |
+| published topics. A topic earns an alias after a few      |
+| publishes; once every alias is taken, a clearly hotter    |
+| topic takes over the alias of the coldest one. Hit counts |
+| are halved periodically so the table follows what is      |
+| being published now rather than since startup.            |
+|                                                           |
+| Aliases are per connection - reset() on every CONNACK.    |
+\*---------------------------------------------------------*/
+
+class TopicAliasTable
+{
+public:
+    // maximum is the number of aliases available, 0 disables aliasing
+    void reset(quint16 maximum);
+
+    // Alias to publish under, or 0 to send the full topic. remapped is set when
+    // the alias is new for this topic, in which case the topic must go out with it.
+    quint16 aliasFor(const QString& topic, bool& remapped);
+
+    quint16 capacity() const { return static_cast<quint16>(alias_topics.size()); }
+
+private:
+    std::vector<QString> alias_topics;  // alias - 1 -> topic
+    QHash<QString, quint16> aliases;    // topic -> alias
+    QHash<QString, quint32> hits;       // recent publish count per topic
+    quint32 lookups = 0;
+
+    void decay();
+};
@@ -0,0 +1,38 @@
+#include "TopicTable.h"
+#include "OpenRGB/LogManager.h"
+
+TopicTable::TopicTable(int max_topics)
+    : maxTopics(max_topics)
+    , fullLogged(false)
+{
+}
+
+TopicId TopicTable::intern(const QString& topic)
+{
+    // Nearly every topic has been seen before, so the shared lock is the common path
+    {
+        QReadLocker locker(&lock);
+        auto it = ids.constFind(topic);
+        if (it != ids.constEnd()) {
+            return it.value();
+        }
+    }
+
+    QWriteLocker locker(&lock);
+    auto it = ids.constFind(topic);
+    if (it != ids.constEnd()) {
+        return it.value();
+    }
+
+    if (ids.size() >= maxTopics) {
+        if (!fullLogged) {
+            fullLogged = true;
+            LOG_WARNING("[TopicTable] Topic table full at %d topics, new topics are not interned", maxTopics);
+        }
+        return INVALID_TOPIC_ID;
+    }
+
+    const TopicId id = static_cast<TopicId>(ids.size() + 1);
+    ids.insert(topic, id);
+    return id;
+}
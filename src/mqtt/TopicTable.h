@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QString>
+#include <QHash>
+#include <QReadWriteLock>
+
+/*---------------------------------------------------------*\
+| TopicTable                                                |
+|                                                           |
+| Interns inbound topic names into small integer ids. The   |
+| network thread interns each topic once at ingress; the    |
+| rest of the pipeline can key on the id instead of hashing |
+| and comparing the string again. Ids are never reused, so  |
+| the table stops growing at its limit and hands out        |
+| INVALID_TOPIC_ID, which callers treat as "use the string".|
+\*---------------------------------------------------------*/
+
+typedef quint32 TopicId;
+const TopicId INVALID_TOPIC_ID = 0;
+
+class TopicTable
+{
+public:
+    explicit TopicTable(int max_topics = 65536);
+
+    // Thread-safe - returns the existing id or assigns the next one
+    TopicId intern(const QString& topic);
+
+private:
+    QReadWriteLock lock;
+    QHash<QString, TopicId> ids;
+    int maxTopics;
+    bool fullLogged;
+};
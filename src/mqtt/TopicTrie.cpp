@@ -0,0 +1,225 @@
+#include "TopicTrie.h"
+#include <QStringList>
+#include <QVarLengthArray>
+#include <algorithm>
+#include "OpenRGB/LogManager.h"
+
+TopicTrie::TopicTrie()
+    : root(new Node())
+    , next_route_id(1)
+{
+}
+
+TopicTrie::~TopicTrie()
+{
+    deleteNode(root);
+}
+
+void TopicTrie::deleteNode(Node* node)
+{
+    if (!node) {
+        return;
+    }
+
+    for (Node* child : node->children) {
+        deleteNode(child);
+    }
+    deleteNode(node->single_wildcard);
+    deleteNode(node->multi_wildcard);
+    delete node;
+}
+
+TopicTrie::Node* TopicTrie::findChild(const Node* node, const QStringRef& level)
+{
+    const uint hash = qHash(level);
+    auto it = node->children.constFind(hash);
+    while (it != node->children.constEnd() && it.key() == hash) {
+        if (it.value()->level == level) {
+            return it.value();
+        }
+        ++it;
+    }
+    return nullptr;
+}
+
+TopicTrie::Node* TopicTrie::findOrCreateChild(Node* node, const QString& level)
+{
+    if (level == QLatin1String("+")) {
+        if (!node->single_wildcard) {
+            node->single_wildcard = new Node();
+            node->single_wildcard->level = level;
+        }
+        return node->single_wildcard;
+    }
+
+    if (level == QLatin1String("#")) {
+        if (!node->multi_wildcard) {
+            node->multi_wildcard = new Node();
+            node->multi_wildcard->level = level;
+        }
+        return node->multi_wildcard;
+    }
+
+    Node* child = findChild(node, QStringRef(&level));
+    if (!child) {
+        child = new Node();
+        child->level = level;
+        node->children.insert(qHash(level), child);
+    }
+    return child;
+}
+
+int TopicTrie::insert(const QString& filter, Handler handler)
+{
+    const QStringList levels = filter.split(QLatin1Char('/'));
+
+    // '#' is only valid as the last level of a filter
+    for (int i = 0; i < levels.size() - 1; i++) {
+        if (levels[i] == QLatin1String("#")) {
+            LOG_WARNING("[TopicTrie] Invalid topic filter: %s", qUtf8Printable(filter));
+            return -1;
+        }
+    }
+
+    Node* node = root;
+    for (const QString& level : levels) {
+        node = findOrCreateChild(node, level);
+    }
+
+    const int id = next_route_id++;
+    node->routes.push_back({id, std::move(handler)});
+    route_nodes.insert(id, node);
+    id_cache.clear();
+    return id;
+}
+
+void TopicTrie::remove(int route_id)
+{
+    auto it = route_nodes.find(route_id);
+    if (it == route_nodes.end()) {
+        return;
+    }
+
+    // Empty nodes are left in place, they are reused if the filter comes back
+    std::vector<Route>& routes = it.value()->routes;
+    routes.erase(std::remove_if(routes.begin(), routes.end(),
+                                [route_id](const Route& route) { return route.id == route_id; }),
+                 routes.end());
+    route_nodes.erase(it);
+    id_cache.clear();
+}
+
+void TopicTrie::clear()
+{
+    deleteNode(root);
+    root = new Node();
+    route_nodes.clear();
+    id_cache.clear();
+}
+
+template<typename Visitor>
+void TopicTrie::visitMatches(const QString& topic, Visitor visit) const
+{
+    // Two frontiers are swapped level by level; inline storage covers typical fan-out
+    QVarLengthArray<const Node*, 8> frontiers[2];
+    int current = 0;
+    frontiers[current].append(root);
+
+    // Wildcards at the first level never match $SYS style topics
+    const bool system_topic = topic.startsWith(QLatin1Char('$'));
+    bool first_level = true;
+    int start = 0;
+
+    while (true) {
+        const int end = topic.indexOf(QLatin1Char('/'), start);
+        const QStringRef level = topic.midRef(start, (end < 0 ? topic.size() : end) - start);
+        const bool wildcards_allowed = !(first_level && system_topic);
+
+        QVarLengthArray<const Node*, 8>& next = frontiers[current ^ 1];
+        next.clear();
+
+        for (const Node* node : frontiers[current]) {
+            // '#' swallows this level and everything after it
+            if (node->multi_wildcard && wildcards_allowed) {
+                visit(node->multi_wildcard->routes);
+            }
+            if (const Node* child = findChild(node, level)) {
+                next.append(child);
+            }
+            if (node->single_wildcard && wildcards_allowed) {
+                next.append(node->single_wildcard);
+            }
+        }
+
+        current ^= 1;
+        if (frontiers[current].isEmpty() || end < 0) {
+            break;
+        }
+
+        start = end + 1;
+        first_level = false;
+    }
+
+    for (const Node* node : frontiers[current]) {
+        visit(node->routes);
+
+        // "a/#" also matches the parent level "a"
+        if (node->multi_wildcard) {
+            visit(node->multi_wildcard->routes);
+        }
+    }
+}
+
+bool TopicTrie::dispatch(const QString& topic, const QByteArray& payload) const
+{
+    // Collect first so handlers may add or remove routes while being called
+    QVarLengthArray<Handler, 4> handlers;
+    visitMatches(topic, [&handlers](const std::vector<Route>& routes) {
+        for (const Route& route : routes) {
+            handlers.append(route.handler);
+        }
+    });
+
+    for (const Handler& handler : handlers) {
+        handler(topic, payload);
+    }
+    return !handlers.isEmpty();
+}
+
+bool TopicTrie::dispatch(TopicId topic_id, const QString& topic, const QByteArray& payload) const
+{
+    if (topic_id == INVALID_TOPIC_ID) {
+        return dispatch(topic, payload);
+    }
+
+    auto it = id_cache.constFind(topic_id);
+    if (it == id_cache.constEnd()) {
+        std::vector<Handler> matched;
+        visitMatches(topic, [&matched](const std::vector<Route>& routes) {
+            for (const Route& route : routes) {
+                matched.push_back(route.handler);
+            }
+        });
+        it = id_cache.insert(topic_id, std::move(matched));
+    }
+
+    // Copied out because a handler may change the routes and drop the cache
+    QVarLengthArray<Handler, 4> handlers;
+    for (const Handler& handler : it.value()) {
+        handlers.append(handler);
+    }
+
+    for (const Handler& handler : handlers) {
+        handler(topic, payload);
+    }
+    return !handlers.isEmpty();
+}
+
+bool TopicTrie::matches(const QString& topic) const
+{
+    bool found = false;
+    visitMatches(topic, [&found](const std::vector<Route>& routes) {
+        found = found || !routes.empty();
+    });
+    return found;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <QString>
+#include <QStringRef>
+#include <QByteArray>
+#include <QMultiHash>
+#include <QHash>
+#include <functional>
+#include <vector>
+#include "TopicTable.h"
+
+/*---------------------------------------------------------*\
+| TopicTrie                                                 |
+|                                                           |
+| Routes inbound MQTT topics to handlers registered against |
+| topic filters. Filters may use the standard '+' (single   |
+| level) and '#' (remaining levels) wildcards. A topic is   |
+| matched in a single pass over its levels without          |
+| allocating per-level strings. Dispatch by interned topic  |
+| id remembers each topic's handlers until the routes next  |
+| change.                                                   |
+\*---------------------------------------------------------*/
+
+class TopicTrie
+{
+public:
+    typedef std::function<void(const QString& topic, const QByteArray& payload)> Handler;
+
+    TopicTrie();
+    ~TopicTrie();
+
+    TopicTrie(const TopicTrie&) = delete;
+    TopicTrie& operator=(const TopicTrie&) = delete;
+
+    // Register a handler for a filter, returns an id usable with remove()
+    int insert(const QString& filter, Handler handler);
+    void remove(int route_id);
+    void clear();
+
+    // Invoke every handler whose filter matches, returns false if none did
+    bool dispatch(const QString& topic, const QByteArray& payload) const;
+    bool dispatch(TopicId topic_id, const QString& topic, const QByteArray& payload) const;
+    bool matches(const QString& topic) const;
+
+    int size() const { return route_nodes.size(); }
+
+private:
+    struct Route {
+        int id;
+        Handler handler;
+    };
+
+    struct Node {
+        QString level;
+        QMultiHash<uint, Node*> children;
+        Node* single_wildcard = nullptr;    // '+'
+        Node* multi_wildcard = nullptr;     // '#'
+        std::vector<Route> routes;
+    };
+
+    Node* root;
+    QHash<int, Node*> route_nodes;
+    int next_route_id;
+
+    // Matched handlers per interned topic, dropped whenever a route is added or removed
+    mutable QHash<TopicId, std::vector<Handler>> id_cache;
+
+    static void deleteNode(Node* node);
+    static Node* findChild(const Node* node, const QStringRef& level);
+    Node* findOrCreateChild(Node* node, const QString& level);
+
+    template<typename Visitor>
+    void visitMatches(const QString& topic, Visitor visit) const;
+};
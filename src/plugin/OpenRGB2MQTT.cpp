@@ -2,6 +2,10 @@
 #include "mqtt/MQTTHandler.h"
 #include "devices/DeviceManager.h"
 #include "config/ConfigManager.h"
+#include "mqtt/BridgeMetrics.h"
+#include "utils/Trace.h"
+#include "utils/LatencyHistogram.h"
+#include "utils/StageMetrics.h"
 #include <QVBoxLayout>
 #include <QGridLayout>
 #include <QLineEdit>
@@ -30,6 +34,7 @@ OpenRGB2MQTT::OpenRGB2MQTT() :
     mqtt_handler(nullptr),
     device_manager(nullptr),
     config_manager(nullptr),
+    bridge_metrics(nullptr),
     main_widget(nullptr),
     components_initialized(false),
     post_discovery_timer(nullptr)
@@ -70,6 +75,9 @@ void OpenRGB2MQTT::Load(ResourceManagerInterface* resource_manager_ptr)
 
     resource_manager = resource_manager_ptr;
 
+    // Carried across the queued publish connection
+    qRegisterMetaType<PublishOptions>("PublishOptions");
+
     try {
         // Detect dark theme
         if (QApplication::palette().color(QPalette::Window).lightness() < 128) {
@@ -87,6 +95,33 @@ void OpenRGB2MQTT::Load(ResourceManagerInterface* resource_manager_ptr)
             throw std::runtime_error("Failed to create MQTTHandler");
         }
 
+        // Extra connections have to exist before the per-connection settings below
+        mqtt_handler->setConnectionPoolSize(config_manager->getConnectionPoolSize());
+
+        // Apply inbound queue limits from config
+        mqtt_handler->setQueueLimits(
+            config_manager->getInboundQueueMaxBytes(),
+            config_manager->getInboundOverflowPolicy() == "drop_oldest" ? MQTTHandler::DropOldest
+                                                                        : MQTTHandler::DropNewest);
+        mqtt_handler->setDrainBudget(config_manager->getInboundDrainBudgetUsec());
+        mqtt_handler->setPublishFlushInterval(config_manager->getPublishFlushIntervalMs());
+        mqtt_handler->setRateLimits(config_manager->getRateLimits());
+        mqtt_handler->setStreamingExpiry(config_manager->getStreamingExpirySec());
+        mqtt_handler->setOfflineBufferLimit(config_manager->getOfflineBufferMaxBytes());
+        mqtt_handler->setBackpressureWatermarks(
+            config_manager->getBackpressureHighBytes(),
+            config_manager->getBackpressureLowBytes());
+        mqtt_handler->setReconnectBackoff(
+            config_manager->getReconnectMinMs(),
+            config_manager->getReconnectMaxMs());
+        mqtt_handler->setReliability(
+            static_cast<quint8>(config_manager->getFinalStateQos()),
+            config_manager->getMaxInFlight());
+        mqtt_handler->setProtocol(
+            config_manager->getProtocolVersion() == "3.1.1" ? QMqttClient::MQTT_3_1_1
+                                                            : QMqttClient::MQTT_5_0,
+            static_cast<quint16>(config_manager->getTopicAliasMaximum()));
+
         device_manager = new DeviceManager(resource_manager, this);
         if (!device_manager) {
             throw std::runtime_error("Failed to create DeviceManager");
@@ -96,6 +131,12 @@ void OpenRGB2MQTT::Load(ResourceManagerInterface* resource_manager_ptr)
         device_manager->setConfigManager(config_manager);
         device_manager->setMQTTHandler(mqtt_handler);
 
+        bridge_metrics = new BridgeMetrics(mqtt_handler, device_manager, this);
+        bridge_metrics->setBaseTopic(config_manager->getBaseTopic());
+        bridge_metrics->configure(
+            config_manager->getMetricsIntervalSec(),
+            config_manager->getMetricsSections());
+
         // Create GUI components
         createMainWidget();
 
@@ -115,7 +156,8 @@ void OpenRGB2MQTT::delayedInit()
     try {
         // Connect signals/slots with Direct connection for thread safety
         if (mqtt_handler && device_manager) {
-            // Direct connection for MQTT messages to ensure immediate processing
+            // messageReceived is emitted on this thread once the network thread hands a message over,
+            // so a direct connection dispatches immediately without another queue hop
             connect(mqtt_handler, &MQTTHandler::messageReceived,
                     device_manager, &DeviceManager::handleMQTTMessage,
                     Qt::DirectConnection);
@@ -126,14 +168,26 @@ void OpenRGB2MQTT::delayedInit()
         if (device_manager && mqtt_handler) {
             // Connect device manager to MQTT handler for publishing
             connect(device_manager, &DeviceManager::mqttPublishNeeded,
-                    this, [this](const QString& topic, const QByteArray& payload) {
+                    this, [this](const QString& topic, const QByteArray& payload, const PublishOptions& options) {
                         if (mqtt_handler) {
-                            LOG_DEBUG("Publishing to MQTT topic: %s", qUtf8Printable(topic));
-                            mqtt_handler->publish(topic, payload);
+                            // Coalesced - only the newest payload per topic is sent each tick
+                            mqtt_handler->queuePublish(topic, payload, options);
                         }
                     }, Qt::QueuedConnection);
                     
             LOG_INFO("Connected DeviceManager publish signal to MQTT handler");
+
+            // Protocol managers ask for topic filters; the handler reference counts them
+            connect(device_manager, &DeviceManager::subscriptionNeeded,
+                    mqtt_handler, [this](const QString& filter) {
+                        mqtt_handler->addSubscription(filter);
+                    });
+            connect(device_manager, &DeviceManager::unsubscriptionNeeded,
+                    mqtt_handler, &MQTTHandler::removeSubscription);
+
+            // After an outage the broker and devices may have drifted - push our state again
+            connect(mqtt_handler, &MQTTHandler::connectionRecovered,
+                    device_manager, &DeviceManager::resyncDeviceStates);
         }
                 
 
@@ -305,8 +359,23 @@ void OpenRGB2MQTT::createMQTTTab(QTabWidget* tabWidget)
     mqtt_status_label = new QLabel("Disconnected");
     connect_button = new QPushButton("Connect");
 
+    // Writes the in-memory trace buffer to the OpenRGB log
+    QPushButton* dump_trace_button = new QPushButton("Dump Trace");
+    connect(dump_trace_button, &QPushButton::clicked, this, []() {
+        Trace::dumpToLog();
+    });
+
     status_layout->addWidget(mqtt_status_label);
     status_layout->addWidget(connect_button);
+    // Per-protocol frame latency and per-stage pipeline latency percentiles, as JSON lines in the log
+    QPushButton* dump_latency_button = new QPushButton("Dump Latency");
+    connect(dump_latency_button, &QPushButton::clicked, this, []() {
+        Latency::dumpToLog();
+        StageMetrics::dumpToLog();
+    });
+
+    status_layout->addWidget(dump_trace_button);
+    status_layout->addWidget(dump_latency_button);
 
     // Connect button handler
     connect(connect_button, &QPushButton::clicked, this, &OpenRGB2MQTT::onConnectButtonClicked);
@@ -617,6 +686,17 @@ void OpenRGB2MQTT::initializeConnection()
         "offline"
     );
 
+    if (bridge_metrics) {
+        bridge_metrics->setBaseTopic(base_topic->text());
+    }
+
+    // Resume the same broker session across reconnects and restarts
+    mqtt_handler->setSession(
+        client_id->text(),
+        config_manager->getPersistentSession(),
+        static_cast<quint32>(config_manager->getSessionExpirySec())
+    );
+
     // Connect to broker
     mqtt_handler->connectToHost(
         broker_url->text(),
@@ -657,6 +737,12 @@ void OpenRGB2MQTT::updateMQTTStatus(bool connected)
 
 void OpenRGB2MQTT::cleanup()
 {
+    // Reads from the handler and device manager, so it goes first
+    if (bridge_metrics) {
+        delete bridge_metrics;
+        bridge_metrics = nullptr;
+    }
+
     if (mqtt_handler) {
         mqtt_handler->disconnect();
         delete mqtt_handler;
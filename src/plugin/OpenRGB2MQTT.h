@@ -56,6 +56,7 @@ private:
     class MQTTHandler* mqtt_handler;
     class DeviceManager* device_manager;
     class ConfigManager* config_manager;
+    class BridgeMetrics* bridge_metrics;
     QWidget* main_widget;
     QMutex init_mutex;
     bool components_initialized;
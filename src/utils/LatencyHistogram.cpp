@@ -0,0 +1,170 @@
+#include "utils/LatencyHistogram.h"
+#include <QMutex>
+#include <QtAlgorithms>
+#include <QMutexLocker>
+#include <QMap>
+#include <QJsonDocument>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include "OpenRGB/LogManager.h"
+
+void LatencyHistogram::Snapshot::merge(const Snapshot& other)
+{
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        buckets[i] += other.buckets[i];
+    }
+    count += other.count;
+    sum_ns += other.sum_ns;
+    max_ns = qMax(max_ns, other.max_ns);
+}
+
+quint64 LatencyHistogram::Snapshot::percentileNs(double fraction) const
+{
+    if (count == 0) {
+        return 0;
+    }
+
+    // Rank of the sample we want, 1-based and rounded up
+    quint64 rank = static_cast<quint64>(std::ceil(fraction * count));
+    rank = qBound<quint64>(1, rank, count);
+
+    quint64 seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return qMin(bucketUpperBound(i), max_ns);
+        }
+    }
+    return max_ns;
+}
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+int LatencyHistogram::bucketFor(quint64 value_ns)
+{
+    if (value_ns < static_cast<quint64>(SUB_BUCKETS)) {
+        return static_cast<int>(value_ns);
+    }
+
+    const int msb = 63 - qCountLeadingZeroBits(value_ns);
+    const int shift = msb - SUB_BUCKET_BITS;
+    const int sub = static_cast<int>((value_ns >> shift) & (SUB_BUCKETS - 1));
+    return (shift + 1) * SUB_BUCKETS + sub;
+}
+
+quint64 LatencyHistogram::bucketUpperBound(int index)
+{
+    if (index < SUB_BUCKETS) {
+        return static_cast<quint64>(index);
+    }
+
+    const int shift = index / SUB_BUCKETS - 1;
+    const quint64 sub = static_cast<quint64>(index % SUB_BUCKETS);
+    const quint64 lower = (static_cast<quint64>(SUB_BUCKETS) + sub) << shift;
+    return lower + ((Q_UINT64_C(1) << shift) - 1);
+}
+
+void LatencyHistogram::record(qint64 latency_ns)
+{
+    const quint64 value = latency_ns > 0 ? static_cast<quint64>(latency_ns) : 0;
+
+    buckets[bucketFor(value)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(value, std::memory_order_relaxed);
+
+    quint64 current = max.load(std::memory_order_relaxed);
+    while (value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const
+{
+    // Not an atomic cut across buckets - a sample recorded meanwhile may be half counted
+    Snapshot snap;
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        snap.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+    }
+    snap.count = count.load(std::memory_order_relaxed);
+    snap.sum_ns = sum.load(std::memory_order_relaxed);
+    snap.max_ns = max.load(std::memory_order_relaxed);
+    return snap;
+}
+
+void LatencyHistogram::reset()
+{
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        buckets[i].store(0, std::memory_order_relaxed);
+    }
+    count.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+}
+
+namespace
+{
+    QMutex registry_mutex;
+    QMap<QString, std::shared_ptr<LatencyHistogram>> protocol_histograms;
+    std::atomic<qint64> window_start_ns{Latency::nowNs()};
+
+    double toUsec(quint64 ns)
+    {
+        return ns / 1000.0;
+    }
+}
+
+qint64 Latency::nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+LatencyHistogram* Latency::forProtocol(const QString& protocol)
+{
+    QMutexLocker locker(&registry_mutex);
+    std::shared_ptr<LatencyHistogram>& histogram = protocol_histograms[protocol];
+    if (!histogram) {
+        histogram = std::make_shared<LatencyHistogram>();
+    }
+    return histogram.get();
+}
+
+QJsonObject Latency::report()
+{
+    const double elapsed_s = (nowNs() - window_start_ns.load()) / 1e9;
+
+    QJsonObject result;
+    QMutexLocker locker(&registry_mutex);
+    for (auto it = protocol_histograms.constBegin(); it != protocol_histograms.constEnd(); ++it) {
+        const LatencyHistogram::Snapshot snap = it.value()->snapshot();
+
+        QJsonObject entry;
+        entry["count"] = static_cast<double>(snap.count);
+        entry["rate_per_s"] = elapsed_s > 0 ? snap.count / elapsed_s : 0.0;
+        entry["mean_us"] = toUsec(snap.meanNs());
+        entry["p50_us"] = toUsec(snap.percentileNs(0.5));
+        entry["p99_us"] = toUsec(snap.percentileNs(0.99));
+        entry["p999_us"] = toUsec(snap.percentileNs(0.999));
+        entry["max_us"] = toUsec(snap.max_ns);
+        result[it.key()] = entry;
+    }
+    return result;
+}
+
+void Latency::reset()
+{
+    QMutexLocker locker(&registry_mutex);
+    for (const auto& histogram : protocol_histograms) {
+        histogram->reset();
+    }
+    window_start_ns.store(nowNs());
+}
+
+void Latency::dumpToLog()
+{
+    const QByteArray json = QJsonDocument(report()).toJson(QJsonDocument::Compact);
+    LOG_INFO("[Latency] %s", json.constData());
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <QtGlobal>
+#include <QString>
+#include <QJsonObject>
+#include <atomic>
+#include <vector>
+
+/*---------------------------------------------------------*\
+| LatencyHistogram                                          |
+|                                                           |
+| HDR-style histogram of nanosecond latencies: buckets are  |
+| log-linear, 16 per power of two, so any value is kept to  |
+| within about 6% over the whole 64-bit range in a fixed    |
+| 8 KB. Recording is a few relaxed atomic adds and never    |
+| blocks; snapshots may be taken from any thread.           |
+\*---------------------------------------------------------*/
+
+class LatencyHistogram
+{
+public:
+    static const int SUB_BUCKET_BITS = 4;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    struct Snapshot {
+        std::vector<quint64> buckets = std::vector<quint64>(BUCKET_COUNT, 0);
+        quint64 count = 0;
+        quint64 sum_ns = 0;
+        quint64 max_ns = 0;
+
+        void merge(const Snapshot& other);
+
+        // Upper bound of the bucket holding the given fraction (0.5, 0.99, 0.999) of samples
+        quint64 percentileNs(double fraction) const;
+        quint64 meanNs() const { return count > 0 ? sum_ns / count : 0; }
+    };
+
+    LatencyHistogram();
+
+    void record(qint64 latency_ns);
+    Snapshot snapshot() const;
+    void reset();
+
+    static int bucketFor(quint64 value_ns);
+    static quint64 bucketUpperBound(int index);
+
+private:
+    std::atomic<quint64> buckets[BUCKET_COUNT];
+    std::atomic<quint64> count;
+    std::atomic<quint64> sum;
+    std::atomic<quint64> max;
+};
+
+/*---------------------------------------------------------*\
+| Latency                                                   |
+|                                                           |
+| Frame latency from the device producing a frame to the    |
+| frame being handed to QMqttClient, one histogram per      |
+| protocol. Devices stamp PublishOptions::origin_ns and     |
+| carry their protocol's histogram; the connection records  |
+| the difference once the publish is written.               |
+\*---------------------------------------------------------*/
+
+namespace Latency
+{
+    // Monotonic clock shared by every timestamp compared against a histogram
+    qint64 nowNs();
+
+    // Created on first use and never freed, so the pointer can be cached by devices
+    LatencyHistogram* forProtocol(const QString& protocol);
+
+    // { "<protocol>": { count, rate_per_s, mean_us, p50_us, p99_us, p999_us, max_us }, ... }
+    // rate_per_s is the average since startup or the last reset
+    QJsonObject report();
+    void reset();
+
+    // Writes report() to the OpenRGB log as one compact JSON line
+    void dumpToLog();
+}
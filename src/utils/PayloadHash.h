@@ -0,0 +1,27 @@
+#pragma once
+
+#include <QtGlobal>
+#include <QByteArray>
+
+/*---------------------------------------------------------*\
+| PayloadHash                                               |
+|                                                           |
+| 64-bit FNV-1a over raw payload bytes. Used to recognise a |
+| repeated MQTT payload without parsing it. Unlike qHash it |
+| is unseeded, so hashes can be saved and compared across   |
+| runs.                                                     |
+\*---------------------------------------------------------*/
+
+namespace PayloadHash
+{
+    inline quint64 fnv1a(const QByteArray& payload)
+    {
+        quint64 hash = 14695981039346656037ULL;
+        const char* data = payload.constData();
+        for (int i = 0; i < payload.size(); i++) {
+            hash ^= static_cast<quint8>(data[i]);
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+}
@@ -0,0 +1,100 @@
+#include "utils/StageMetrics.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <QJsonDocument>
+#include <memory>
+#include <vector>
+#include "OpenRGB/LogManager.h"
+
+namespace
+{
+    struct ThreadHistograms {
+        LatencyHistogram stages[StageMetrics::STAGE_COUNT];
+    };
+
+    // Sets outlive their threads so samples from finished threads stay in the totals
+    QMutex registry_mutex;
+    std::vector<std::shared_ptr<ThreadHistograms>> thread_sets;
+
+    thread_local ThreadHistograms* local_set = nullptr;
+
+    ThreadHistograms* registerThread()
+    {
+        // Taken once per thread, on its first sample
+        std::shared_ptr<ThreadHistograms> set = std::make_shared<ThreadHistograms>();
+        QMutexLocker locker(&registry_mutex);
+        thread_sets.push_back(set);
+        return set.get();
+    }
+
+    double toUsec(quint64 ns)
+    {
+        return ns / 1000.0;
+    }
+}
+
+const char* StageMetrics::stageName(Stage stage)
+{
+    switch (stage) {
+        case Ingress:       return "ingress";
+        case QueueWait:     return "queue_wait";
+        case Dispatch:      return "dispatch";
+        case DeviceUpdate:  return "device_update";
+        case PublishEmit:   return "publish_emit";
+        case ClientPublish: return "client_publish";
+        default:            return "unknown";
+    }
+}
+
+void StageMetrics::record(Stage stage, qint64 latency_ns)
+{
+    if (!local_set) {
+        local_set = registerThread();
+    }
+    local_set->stages[stage].record(latency_ns);
+}
+
+LatencyHistogram::Snapshot StageMetrics::snapshot(Stage stage)
+{
+    LatencyHistogram::Snapshot merged;
+    QMutexLocker locker(&registry_mutex);
+    for (const auto& set : thread_sets) {
+        merged.merge(set->stages[stage].snapshot());
+    }
+    return merged;
+}
+
+QJsonObject StageMetrics::report()
+{
+    QJsonObject result;
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        const Stage stage = static_cast<Stage>(i);
+        const LatencyHistogram::Snapshot snap = snapshot(stage);
+
+        QJsonObject entry;
+        entry["count"] = static_cast<double>(snap.count);
+        entry["mean_us"] = toUsec(snap.meanNs());
+        entry["p50_us"] = toUsec(snap.percentileNs(0.5));
+        entry["p99_us"] = toUsec(snap.percentileNs(0.99));
+        entry["p999_us"] = toUsec(snap.percentileNs(0.999));
+        entry["max_us"] = toUsec(snap.max_ns);
+        result[stageName(stage)] = entry;
+    }
+    return result;
+}
+
+void StageMetrics::reset()
+{
+    QMutexLocker locker(&registry_mutex);
+    for (const auto& set : thread_sets) {
+        for (LatencyHistogram& histogram : set->stages) {
+            histogram.reset();
+        }
+    }
+}
+
+void StageMetrics::dumpToLog()
+{
+    const QByteArray json = QJsonDocument(report()).toJson(QJsonDocument::Compact);
+    LOG_INFO("[StageMetrics] %s", json.constData());
+}
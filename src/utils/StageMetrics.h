@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QtGlobal>
+#include <QJsonObject>
+#include "utils/LatencyHistogram.h"
+
+/*---------------------------------------------------------*\
+| StageMetrics                                              |
+|                                                           |
+| Always-on latency histograms for each stage of the bridge |
+| pipeline. Every thread records into its own set of        |
+| histograms, so recording never contends or locks; a query |
+| merges the sets of all threads that ever recorded.        |
+\*---------------------------------------------------------*/
+
+namespace StageMetrics
+{
+    enum Stage {
+        Ingress,        // MQTTHandler::handleMessage on the network thread
+        QueueWait,      // Inbound message waiting in the ring buffer until dequeued
+        Dispatch,       // DeviceManager routing one message to the protocol managers
+        DeviceUpdate,   // A device applying an inbound state
+        PublishEmit,    // Device frame until mqttPublishNeeded reaches MQTTHandler
+        ClientPublish,  // QMqttClient::publish
+        STAGE_COUNT
+    };
+
+    const char* stageName(Stage stage);
+
+    void record(Stage stage, qint64 latency_ns);
+
+    // Merged over all threads
+    LatencyHistogram::Snapshot snapshot(Stage stage);
+
+    // { "<stage>": { count, mean_us, p50_us, p99_us, p999_us, max_us }, ... }
+    QJsonObject report();
+    void reset();
+
+    // Writes report() to the OpenRGB log as one compact JSON line
+    void dumpToLog();
+
+    // Records the time from construction to destruction
+    class ScopedTimer
+    {
+    public:
+        explicit ScopedTimer(Stage stage) : stage(stage), start_ns(Latency::nowNs()) {}
+        ~ScopedTimer() { record(stage, Latency::nowNs() - start_ns); }
+
+    private:
+        Stage stage;
+        qint64 start_ns;
+    };
+}
@@ -0,0 +1,116 @@
+#include "utils/Trace.h"
+#include <QThread>
+#include <QString>
+#include <atomic>
+#include <chrono>
+#include "OpenRGB/LogManager.h"
+
+namespace
+{
+    const quint64 TRACE_CAPACITY = 8192;    // Must be a power of two
+
+    // Each slot is a small seqlock: sequence is 0 while a writer owns it, index + 1 once complete
+    struct Slot {
+        std::atomic<quint64> sequence{0};
+        std::atomic<qint64> timestamp_ns{0};
+        std::atomic<quintptr> thread_id{0};
+        std::atomic<const char*> category{nullptr};
+        std::atomic<const char*> event{nullptr};
+        std::atomic<quint64> arg0{0};
+        std::atomic<quint64> arg1{0};
+        std::atomic<int> level{0};
+    };
+
+    Slot trace_slots[TRACE_CAPACITY];
+    std::atomic<quint64> next_index{0};
+
+    qint64 nowNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    const char* levelName(int level)
+    {
+        switch (level) {
+            case TRACE_LEVEL_ERROR: return "E";
+            case TRACE_LEVEL_INFO:  return "I";
+            case TRACE_LEVEL_DEBUG: return "D";
+            default:                return "?";
+        }
+    }
+}
+
+void Trace::record(int level, const char* category, const char* event, quint64 arg0, quint64 arg1)
+{
+    const quint64 index = next_index.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = trace_slots[index & (TRACE_CAPACITY - 1)];
+
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.timestamp_ns.store(nowNs(), std::memory_order_relaxed);
+    slot.thread_id.store(reinterpret_cast<quintptr>(QThread::currentThreadId()), std::memory_order_relaxed);
+    slot.category.store(category, std::memory_order_relaxed);
+    slot.event.store(event, std::memory_order_relaxed);
+    slot.arg0.store(arg0, std::memory_order_relaxed);
+    slot.arg1.store(arg1, std::memory_order_relaxed);
+    slot.level.store(level, std::memory_order_relaxed);
+
+    slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+QStringList Trace::dump()
+{
+    QStringList lines;
+
+    const quint64 end = next_index.load(std::memory_order_acquire);
+    const quint64 start = end > TRACE_CAPACITY ? end - TRACE_CAPACITY : 0;
+    qint64 first_ns = -1;
+
+    for (quint64 index = start; index < end; index++) {
+        const Slot& slot = trace_slots[index & (TRACE_CAPACITY - 1)];
+
+        const quint64 before = slot.sequence.load(std::memory_order_acquire);
+        if (before != index + 1) {
+            continue;   // Still being written or already overwritten
+        }
+
+        const qint64 timestamp_ns = slot.timestamp_ns.load(std::memory_order_relaxed);
+        const quintptr thread_id = slot.thread_id.load(std::memory_order_relaxed);
+        const char* category = slot.category.load(std::memory_order_relaxed);
+        const char* event = slot.event.load(std::memory_order_relaxed);
+        const quint64 arg0 = slot.arg0.load(std::memory_order_relaxed);
+        const quint64 arg1 = slot.arg1.load(std::memory_order_relaxed);
+        const int level = slot.level.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != before) {
+            continue;   // Overwritten while we were reading it
+        }
+
+        if (first_ns < 0) {
+            first_ns = timestamp_ns;
+        }
+
+        lines.append(QString("+%1 ms [%2] thread %3 %4/%5 %6 %7")
+                         .arg((timestamp_ns - first_ns) / 1000000.0, 0, 'f', 3)
+                         .arg(levelName(level))
+                         .arg(static_cast<qulonglong>(thread_id), 0, 16)
+                         .arg(category ? category : "?")
+                         .arg(event ? event : "?")
+                         .arg(arg0)
+                         .arg(arg1));
+    }
+
+    return lines;
+}
+
+void Trace::dumpToLog()
+{
+    const QStringList lines = dump();
+    LOG_INFO("[Trace] Dumping %d trace records", lines.size());
+    for (const QString& line : lines) {
+        LOG_INFO("[Trace] %s", qUtf8Printable(line));
+    }
+}
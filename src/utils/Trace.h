@@ -0,0 +1,60 @@
+#pragma once
+
+#include <QtGlobal>
+#include <QStringList>
+
+/*---------------------------------------------------------*\
+| Trace                                                     |
+|                                                           |
+| Structured trace points for the publish and ingest hot    |
+| paths. Records hold a category, an event name and two     |
+| integer arguments - nothing is formatted until the buffer |
+| is dumped. Records go into a fixed-size lock-free ring,   |
+| the oldest are overwritten.                               |
+|                                                           |
+| Set OPENRGB2MQTT_TRACE_LEVEL at build time. Trace points  |
+| above that level expand to nothing and their arguments    |
+| are never evaluated.                                      |
+\*---------------------------------------------------------*/
+
+#define TRACE_LEVEL_OFF     0
+#define TRACE_LEVEL_ERROR   1
+#define TRACE_LEVEL_INFO    2
+#define TRACE_LEVEL_DEBUG   3
+
+#ifndef OPENRGB2MQTT_TRACE_LEVEL
+#define OPENRGB2MQTT_TRACE_LEVEL TRACE_LEVEL_INFO
+#endif
+
+namespace Trace
+{
+    // category and event must be string literals, only the pointers are stored
+    void record(int level, const char* category, const char* event, quint64 arg0, quint64 arg1);
+
+    // Snapshot of the buffer, oldest first, one formatted line per record
+    QStringList dump();
+
+    // Writes dump() to the OpenRGB log
+    void dumpToLog();
+}
+
+#if OPENRGB2MQTT_TRACE_LEVEL >= TRACE_LEVEL_ERROR
+#define TRACE_ERROR(category, event, arg0, arg1) \
+    Trace::record(TRACE_LEVEL_ERROR, category, event, static_cast<quint64>(arg0), static_cast<quint64>(arg1))
+#else
+#define TRACE_ERROR(category, event, arg0, arg1) do {} while (0)
+#endif
+
+#if OPENRGB2MQTT_TRACE_LEVEL >= TRACE_LEVEL_INFO
+#define TRACE_INFO(category, event, arg0, arg1) \
+    Trace::record(TRACE_LEVEL_INFO, category, event, static_cast<quint64>(arg0), static_cast<quint64>(arg1))
+#else
+#define TRACE_INFO(category, event, arg0, arg1) do {} while (0)
+#endif
+
+#if OPENRGB2MQTT_TRACE_LEVEL >= TRACE_LEVEL_DEBUG
+#define TRACE_DEBUG(category, event, arg0, arg1) \
+    Trace::record(TRACE_LEVEL_DEBUG, category, event, static_cast<quint64>(arg0), static_cast<quint64>(arg1))
+#else
+#define TRACE_DEBUG(category, event, arg0, arg1) do {} while (0)
+#endif
@@ -0,0 +1,9 @@
+TEMPLATE = subdirs
+
+SUBDIRS = \
+    brokerstandin \
+    messageringbuffer \
+    mqtthandler \
+    topicaliastable \
+    topictable \
+    topictrie
@@ -0,0 +1,348 @@
+#include <QtTest>
+#include <QTcpSocket>
+#include <QtMqtt/qmqttclient.h>
+#include <memory>
+#include "MQTTBrokerStandIn.h"
+
+/*---------------------------------------------------------*\
+| tst_BrokerStandIn                                         |
+|                                                           |
+| The stand-in is what every other test and benchmark is    |
+| measured against, so its own behaviour is pinned here     |
+| with a plain QMqttClient.                                 |
+\*---------------------------------------------------------*/
+
+class tst_BrokerStandIn : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void topicMatches_data();
+    void topicMatches();
+    void routesToMatchingSubscribers();
+    void retainedMessagesOnSubscribe();
+    void acknowledgesQos1AndQos2();
+    void mqtt5TopicAlias();
+    void injectedLatency();
+    void bandwidthLimit();
+    void willOnUnexpectedDisconnect();
+    void persistentSession();
+    void flapAndRelisten();
+
+private:
+    std::unique_ptr<MQTTBrokerStandIn> broker;
+
+    std::unique_ptr<QMqttClient> connectClient(QMqttClient::ProtocolVersion version = QMqttClient::MQTT_3_1_1,
+                                               const QString& client_id = QString(), bool clean = true);
+    static bool subscribeAndWait(QMqttClient* client, const QString& filter, quint8 qos = 0);
+};
+
+void tst_BrokerStandIn::initTestCase()
+{
+    // Signal arguments QSignalSpy has to store
+    qRegisterMetaType<QMqttTopicName>();
+    qRegisterMetaType<QMqttMessage>();
+}
+
+void tst_BrokerStandIn::init()
+{
+    broker.reset(new MQTTBrokerStandIn);
+    QVERIFY(broker->listen());
+}
+
+void tst_BrokerStandIn::cleanup()
+{
+    broker.reset();
+}
+
+std::unique_ptr<QMqttClient> tst_BrokerStandIn::connectClient(QMqttClient::ProtocolVersion version,
+                                                              const QString& client_id, bool clean)
+{
+    std::unique_ptr<QMqttClient> client(new QMqttClient);
+    client->setHostname("127.0.0.1");
+    client->setPort(broker->port());
+    client->setProtocolVersion(version);
+    client->setCleanSession(clean);
+    if (!client_id.isEmpty())
+        client->setClientId(client_id);
+
+    QSignalSpy connected(client.get(), &QMqttClient::connected);
+    client->connectToHost();
+    if (!connected.wait(5000))
+        return nullptr;
+    return client;
+}
+
+bool tst_BrokerStandIn::subscribeAndWait(QMqttClient* client, const QString& filter, quint8 qos)
+{
+    QMqttSubscription* subscription = client->subscribe(QMqttTopicFilter(filter), qos);
+    if (!subscription)
+        return false;
+    if (subscription->state() != QMqttSubscription::Subscribed) {
+        QSignalSpy state(subscription, &QMqttSubscription::stateChanged);
+        while (subscription->state() != QMqttSubscription::Subscribed) {
+            if (!state.wait(5000))
+                return false;
+        }
+    }
+    return true;
+}
+
+void tst_BrokerStandIn::topicMatches_data()
+{
+    QTest::addColumn<QString>("filter");
+    QTest::addColumn<QString>("topic");
+    QTest::addColumn<bool>("matches");
+
+    QTest::newRow("exact") << "a/b/c" << "a/b/c" << true;
+    QTest::newRow("exact mismatch") << "a/b/c" << "a/b/d" << false;
+    QTest::newRow("plus") << "a/+/c" << "a/b/c" << true;
+    QTest::newRow("plus is one level") << "a/+" << "a/b/c" << false;
+    QTest::newRow("plus empty level") << "a/+/c" << "a//c" << true;
+    QTest::newRow("hash") << "a/#" << "a/b/c" << true;
+    QTest::newRow("hash matches parent") << "a/#" << "a" << true;
+    QTest::newRow("hash alone") << "#" << "a/b" << true;
+    QTest::newRow("shorter topic") << "a/b/c" << "a/b" << false;
+    QTest::newRow("longer topic") << "a/b" << "a/b/c" << false;
+    QTest::newRow("dollar not wildcarded") << "#" << "$SYS/uptime" << false;
+    QTest::newRow("dollar explicit") << "$SYS/#" << "$SYS/uptime" << true;
+    QTest::newRow("ha discovery") << "homeassistant/light/+/+/config" << "homeassistant/light/node/lamp/config" << true;
+}
+
+void tst_BrokerStandIn::topicMatches()
+{
+    QFETCH(QString, filter);
+    QFETCH(QString, topic);
+    QFETCH(bool, matches);
+
+    QCOMPARE(MQTTBrokerStandIn::topicMatches(filter, topic), matches);
+}
+
+void tst_BrokerStandIn::routesToMatchingSubscribers()
+{
+    auto subscriber = connectClient();
+    QVERIFY(subscriber);
+    QVERIFY(subscribeAndWait(subscriber.get(), "home/+/state"));
+    QCOMPARE(broker->subscriptions(), QStringList() << "home/+/state");
+
+    auto publisher = connectClient(QMqttClient::MQTT_5_0);
+    QVERIFY(publisher);
+    QCOMPARE(broker->clientCount(), 2);
+
+    QSignalSpy received(subscriber.get(), &QMqttClient::messageReceived);
+    publisher->publish(QMqttTopicName("home/other/set"), "ignored");
+    publisher->publish(QMqttTopicName("home/lamp/state"), "on");
+
+    QVERIFY(received.wait(5000));
+    QTest::qWait(100);
+    QCOMPARE(received.count(), 1);
+    QCOMPARE(received.at(0).at(0).toByteArray(), QByteArray("on"));
+    QCOMPARE(received.at(0).at(1).value<QMqttTopicName>().name(), QString("home/lamp/state"));
+    QCOMPARE(broker->publishesReceived(), quint64(2));
+}
+
+void tst_BrokerStandIn::retainedMessagesOnSubscribe()
+{
+    broker->publish("homeassistant/light/a/config", "{\"name\":\"a\"}", true);
+    broker->publish("homeassistant/light/b/config", "{\"name\":\"b\"}", true);
+    broker->publish("homeassistant/light/b/config", QByteArray(), true);     // Cleared again
+    QCOMPARE(broker->retainedMessage("homeassistant/light/a/config"), QByteArray("{\"name\":\"a\"}"));
+    QVERIFY(broker->retainedMessage("homeassistant/light/b/config").isEmpty());
+
+    auto client = connectClient();
+    QVERIFY(client);
+
+    QMqttSubscription* subscription = client->subscribe(QMqttTopicFilter("homeassistant/light/+/config"));
+    QVERIFY(subscription);
+    QSignalSpy received(subscription, &QMqttSubscription::messageReceived);
+    QVERIFY(received.wait(5000));
+    QTest::qWait(100);
+
+    QCOMPARE(received.count(), 1);
+    const QMqttMessage message = received.at(0).at(0).value<QMqttMessage>();
+    QCOMPARE(message.topic().name(), QString("homeassistant/light/a/config"));
+    QVERIFY(message.retain());
+}
+
+void tst_BrokerStandIn::acknowledgesQos1AndQos2()
+{
+    for (QMqttClient::ProtocolVersion version : {QMqttClient::MQTT_3_1_1, QMqttClient::MQTT_5_0}) {
+        auto client = connectClient(version);
+        QVERIFY(client);
+
+        QSignalSpy sent(client.get(), &QMqttClient::messageSent);
+        const qint32 qos1 = client->publish(QMqttTopicName("qos/one"), "1", 1);
+        const qint32 qos2 = client->publish(QMqttTopicName("qos/two"), "2", 2);
+        QVERIFY(qos1 > 0);
+        QVERIFY(qos2 > 0);
+
+        QTRY_COMPARE_WITH_TIMEOUT(sent.count(), 2, 5000);
+        QCOMPARE(client->state(), QMqttClient::Connected);
+    }
+}
+
+void tst_BrokerStandIn::mqtt5TopicAlias()
+{
+    broker->setTopicAliasMaximum(8);
+
+    auto client = connectClient(QMqttClient::MQTT_5_0);
+    QVERIFY(client);
+    QCOMPARE(client->serverConnectionProperties().maximumTopicAlias(), quint16(8));
+
+    QSignalSpy published(broker.get(), &MQTTBrokerStandIn::published);
+    QMqttPublishProperties properties;
+    properties.setTopicAlias(1);
+    const QMqttTopicName topic("zigbee2mqtt/a rather long friendly name/set");
+    QVERIFY(client->publish(topic, properties, "#ff000000", 0) != -1);
+    QVERIFY(client->publish(topic, properties, "#00ff0000", 0) != -1);
+
+    QTRY_COMPARE_WITH_TIMEOUT(published.count(), 2, 5000);
+
+    // Both resolve to the full topic, the second one without carrying it
+    QCOMPARE(published.at(0).at(0).toString(), topic.name());
+    QCOMPARE(published.at(1).at(0).toString(), topic.name());
+    QCOMPARE(published.at(1).at(1).toByteArray(), QByteArray("#00ff0000"));
+    QVERIFY(published.at(1).at(3).toInt() < published.at(0).at(3).toInt());
+}
+
+void tst_BrokerStandIn::injectedLatency()
+{
+    auto client = connectClient();
+    QVERIFY(client);
+    QVERIFY(subscribeAndWait(client.get(), "latency/#"));
+
+    broker->setLatency(200);
+
+    QSignalSpy received(client.get(), &QMqttClient::messageReceived);
+    QElapsedTimer timer;
+    timer.start();
+    client->publish(QMqttTopicName("latency/probe"), "x");
+    QVERIFY(received.wait(5000));
+    QVERIFY2(timer.elapsed() >= 190, qPrintable(QString("round trip %1 ms").arg(timer.elapsed())));
+
+    // Order is kept through the delay
+    for (int i = 0; i < 10; i++) {
+        client->publish(QMqttTopicName("latency/probe"), QByteArray::number(i));
+    }
+    QTRY_COMPARE_WITH_TIMEOUT(received.count(), 11, 5000);
+    for (int i = 0; i < 10; i++) {
+        QCOMPARE(received.at(i + 1).at(0).toByteArray(), QByteArray::number(i));
+    }
+}
+
+void tst_BrokerStandIn::bandwidthLimit()
+{
+    auto client = connectClient();
+    QVERIFY(client);
+
+    const qint64 limit = 20000;
+    broker->setBandwidthLimit(limit);
+
+    QSignalSpy published(broker.get(), &MQTTBrokerStandIn::published);
+    const QByteArray payload(2000, 'x');
+    const int count = 10;
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < count; i++) {
+        client->publish(QMqttTopicName("bandwidth/probe"), payload);
+    }
+    QTRY_COMPARE_WITH_TIMEOUT(published.count(), count, 10000);
+
+    // 20 KB at 20 KB/s, less one tick of slack
+    QVERIFY2(timer.elapsed() >= 700, qPrintable(QString("took %1 ms").arg(timer.elapsed())));
+
+    // Lifting the limit reads the rest straight away
+    broker->setBandwidthLimit(0);
+    timer.restart();
+    for (int i = 0; i < count; i++) {
+        client->publish(QMqttTopicName("bandwidth/probe"), payload);
+    }
+    QTRY_COMPARE_WITH_TIMEOUT(published.count(), 2 * count, 5000);
+    QVERIFY(timer.elapsed() < 700);
+}
+
+void tst_BrokerStandIn::willOnUnexpectedDisconnect()
+{
+    auto watcher = connectClient();
+    QVERIFY(watcher);
+    QVERIFY(subscribeAndWait(watcher.get(), "bridge/status"));
+
+    std::unique_ptr<QMqttClient> bridge(new QMqttClient);
+    bridge->setHostname("127.0.0.1");
+    bridge->setPort(broker->port());
+    bridge->setWillTopic("bridge/status");
+    bridge->setWillMessage("offline");
+    bridge->setWillRetain(true);
+    QSignalSpy connected(bridge.get(), &QMqttClient::connected);
+    bridge->connectToHost();
+    QVERIFY(connected.wait(5000));
+
+    // A clean DISCONNECT would suppress the will - cut the socket instead
+    QSignalSpy received(watcher.get(), &QMqttClient::messageReceived);
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(bridge->transport());
+    QVERIFY(socket);
+    socket->abort();
+
+    QVERIFY(received.wait(5000));
+    QCOMPARE(received.at(0).at(0).toByteArray(), QByteArray("offline"));
+    QCOMPARE(broker->retainedMessage("bridge/status"), QByteArray("offline"));
+}
+
+void tst_BrokerStandIn::persistentSession()
+{
+    {
+        auto client = connectClient(QMqttClient::MQTT_3_1_1, "persistent-client", false);
+        QVERIFY(client);
+        QVERIFY(subscribeAndWait(client.get(), "session/#"));
+
+        QSignalSpy gone(broker.get(), &MQTTBrokerStandIn::clientDisconnected);
+        client->disconnectFromHost();
+        QVERIFY(gone.wait(5000));
+    }
+
+    // The broker kept the subscription, so no SUBSCRIBE is needed to receive
+    auto client = connectClient(QMqttClient::MQTT_3_1_1, "persistent-client", false);
+    QVERIFY(client);
+    QCOMPARE(broker->subscriptions(), QStringList() << "session/#");
+
+    QSignalSpy received(client.get(), &QMqttClient::messageReceived);
+    broker->publish("session/x", "kept");
+    QVERIFY(received.wait(5000));
+
+    // A clean session drops it
+    client->disconnectFromHost();
+    QTRY_COMPARE_WITH_TIMEOUT(broker->clientCount(), 0, 5000);
+    auto clean = connectClient(QMqttClient::MQTT_3_1_1, "persistent-client", true);
+    QVERIFY(clean);
+    QVERIFY(broker->subscriptions().isEmpty());
+}
+
+void tst_BrokerStandIn::flapAndRelisten()
+{
+    auto client = connectClient();
+    QVERIFY(client);
+    const quint16 port = broker->port();
+
+    QSignalSpy disconnected(client.get(), &QMqttClient::disconnected);
+    broker->close();
+    QVERIFY(!broker->isListening());
+    QVERIFY(disconnected.wait(5000));
+    QCOMPARE(broker->clientCount(), 0);
+
+    // Back on the same port, so a reconnecting client finds it again
+    QVERIFY(broker->listen());
+    QCOMPARE(broker->port(), port);
+
+    QSignalSpy connected(client.get(), &QMqttClient::connected);
+    client->connectToHost();
+    QVERIFY(connected.wait(5000));
+    QCOMPARE(broker->clientCount(), 1);
+}
+
+QTEST_MAIN(tst_BrokerStandIn)
+#include "tst_brokerstandin.moc"
@@ -0,0 +1,7 @@
+include(../../harness/harness.pri)
+
+QT += testlib
+CONFIG += testcase
+TARGET = tst_messageringbuffer
+
+SOURCES += tst_messageringbuffer.cpp
@@ -0,0 +1,131 @@
+#include <QtTest>
+#include <thread>
+#include "mqtt/MessageRingBuffer.h"
+
+class tst_MessageRingBuffer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void capacityRoundsUpToPowerOfTwo();
+    void fifoOrder();
+    void fullRejectsNewest();
+    void popReleasesPayload();
+    void resetDropsAndResizes();
+    void producerConsumerThreads();
+
+private:
+    static MessageRingBuffer::Message message(int sequence);
+};
+
+MessageRingBuffer::Message tst_MessageRingBuffer::message(int sequence)
+{
+    return {QString("topic/%1").arg(sequence), QByteArray::number(sequence), static_cast<TopicId>(sequence), 0};
+}
+
+void tst_MessageRingBuffer::capacityRoundsUpToPowerOfTwo()
+{
+    QCOMPARE(MessageRingBuffer(0).capacity(), size_t(2));
+    QCOMPARE(MessageRingBuffer(3).capacity(), size_t(4));
+    QCOMPARE(MessageRingBuffer(4096).capacity(), size_t(4096));
+    QCOMPARE(MessageRingBuffer(4097).capacity(), size_t(8192));
+}
+
+void tst_MessageRingBuffer::fifoOrder()
+{
+    MessageRingBuffer ring(8);
+    QVERIFY(ring.isEmpty());
+
+    // Wrap around the end a few times
+    int next_pop = 0;
+    for (int i = 0; i < 100; i++) {
+        QVERIFY(ring.push(message(i)));
+        if (i % 3 == 2) {
+            MessageRingBuffer::Message out;
+            while (ring.pop(out)) {
+                QCOMPARE(out.payload, QByteArray::number(next_pop));
+                QCOMPARE(out.topic_id, static_cast<TopicId>(next_pop));
+                next_pop++;
+            }
+            QVERIFY(ring.isEmpty());
+        }
+    }
+    QCOMPARE(ring.size(), size_t(100 - next_pop));
+}
+
+void tst_MessageRingBuffer::fullRejectsNewest()
+{
+    MessageRingBuffer ring(4);
+    for (int i = 0; i < 4; i++) {
+        QVERIFY(ring.push(message(i)));
+    }
+    QVERIFY(!ring.push(message(4)));
+    QCOMPARE(ring.size(), size_t(4));
+
+    // The rejected message left the queued ones alone
+    MessageRingBuffer::Message out;
+    QVERIFY(ring.pop(out));
+    QCOMPARE(out.payload, QByteArray("0"));
+    QVERIFY(ring.push(message(5)));
+}
+
+void tst_MessageRingBuffer::popReleasesPayload()
+{
+    MessageRingBuffer ring(2);
+    QByteArray payload(1024, 'x');
+    QVERIFY(ring.push({"t", payload, 1, 0}));
+    QVERIFY(!payload.isDetached());     // Shared with the queued copy
+
+    MessageRingBuffer::Message out;
+    QVERIFY(ring.pop(out));
+    out = MessageRingBuffer::Message();
+    QVERIFY(payload.isDetached());      // Nothing left in the slot
+}
+
+void tst_MessageRingBuffer::resetDropsAndResizes()
+{
+    MessageRingBuffer ring(4);
+    QVERIFY(ring.push(message(0)));
+    ring.reset(100);
+    QVERIFY(ring.isEmpty());
+    QCOMPARE(ring.capacity(), size_t(128));
+    for (int i = 0; i < 128; i++) {
+        QVERIFY(ring.push(message(i)));
+    }
+    QVERIFY(!ring.push(message(128)));
+}
+
+void tst_MessageRingBuffer::producerConsumerThreads()
+{
+    const int count = 200000;
+    MessageRingBuffer ring(1024);
+
+    std::thread producer([&ring]() {
+        for (int i = 0; i < count; i++) {
+            while (!ring.push(message(i))) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    int expected = 0;
+    bool in_order = true;
+    MessageRingBuffer::Message out;
+    while (expected < count) {
+        if (!ring.pop(out)) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (out.topic_id != static_cast<TopicId>(expected) || out.payload != QByteArray::number(expected)) {
+            in_order = false;
+        }
+        expected++;
+    }
+    producer.join();
+
+    QVERIFY(in_order);
+    QVERIFY(ring.isEmpty());
+}
+
+QTEST_APPLESS_MAIN(tst_MessageRingBuffer)
+#include "tst_messageringbuffer.moc"
@@ -0,0 +1,312 @@
+#include <QtTest>
+#include <QThread>
+#include <memory>
+#include "MQTTBrokerStandIn.h"
+#include "mqtt/MQTTHandler.h"
+#include "devices/mosquitto/MosquittoLightDevice.h"
+
+/*---------------------------------------------------------*\
+| tst_MQTTHandler                                           |
+|                                                           |
+| MQTTHandler end to end against the broker stand-in. The   |
+| test thread plays the GUI thread; the broker is served    |
+| from its event loop too, so anything that blocked the     |
+| GUI thread would also stall the broker and show up here.  |
+\*---------------------------------------------------------*/
+
+class tst_MQTTHandler : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void messagesArriveOnHandlerThread();
+    void callsDoNotBlockOnSlowBroker();
+    void callsDoNotBlockWithoutBroker();
+    void recoversFromFlappingBroker();
+    void throttledBrokerKeepsMemoryBounded();
+    void backpressureClearsWithNothingPending();
+
+private:
+    std::unique_ptr<MQTTBrokerStandIn> broker;
+    std::unique_ptr<MQTTHandler> handler;
+
+    bool connectHandler();
+};
+
+void tst_MQTTHandler::init()
+{
+    broker.reset(new MQTTBrokerStandIn);
+    QVERIFY(broker->listen());
+    handler.reset(new MQTTHandler);
+}
+
+void tst_MQTTHandler::cleanup()
+{
+    // The handler says goodbye to the broker on its way out
+    handler.reset();
+    broker.reset();
+}
+
+bool tst_MQTTHandler::connectHandler()
+{
+    handler->connectToHost("127.0.0.1", broker->port());
+    return QTest::qWaitFor([this]() { return handler->isConnected(); }, 5000);
+}
+
+void tst_MQTTHandler::messagesArriveOnHandlerThread()
+{
+    QVERIFY(connectHandler());
+    handler->addSubscription("devices/#");
+    QTRY_VERIFY_WITH_TIMEOUT(broker->subscriptions().contains("devices/#"), 5000);
+
+    QThread* delivered_on = nullptr;
+    TopicId delivered_id = INVALID_TOPIC_ID;
+    QByteArray delivered;
+    connect(handler.get(), &MQTTHandler::messageReceived, this,
+            [&](TopicId topic_id, const QString& topic, const QByteArray& payload) {
+        if (topic == "devices/lamp/state") {
+            delivered_on = QThread::currentThread();
+            delivered_id = topic_id;
+            delivered = payload;
+        }
+    });
+
+    broker->publish("devices/lamp/state", "on");
+    QTRY_COMPARE_WITH_TIMEOUT(delivered, QByteArray("on"), 5000);
+    QCOMPARE(delivered_on, handler->thread());
+    QVERIFY(delivered_id != INVALID_TOPIC_ID);
+}
+
+void tst_MQTTHandler::callsDoNotBlockOnSlowBroker()
+{
+    QVERIFY(connectHandler());
+    broker->setLatency(1000);
+
+    QSignalSpy published(broker.get(), &MQTTBrokerStandIn::published);
+
+    // QoS 1 waits for a PUBACK a second away - on the network thread, not here.
+    // Ten stay inside the default in-flight window.
+    QElapsedTimer call_time;
+    call_time.start();
+    for (int i = 0; i < 10; i++) {
+        handler->publish(QString("devices/%1/set").arg(i), "{\"state\":\"ON\"}", 1);
+    }
+    handler->addSubscription("devices/+/state");
+    QVERIFY2(call_time.elapsed() < 100, qPrintable(QString("calls took %1 ms").arg(call_time.elapsed())));
+
+    // The event loop keeps turning while the broker sits on the packets
+    qint64 last_beat = call_time.elapsed();
+    qint64 max_gap = 0;
+    QTimer heartbeat;
+    heartbeat.setInterval(5);
+    connect(&heartbeat, &QTimer::timeout, this, [&]() {
+        max_gap = qMax(max_gap, call_time.elapsed() - last_beat);
+        last_beat = call_time.elapsed();
+    });
+    heartbeat.start();
+
+    QTRY_COMPARE_WITH_TIMEOUT(published.count(), 10, 5000);
+    QVERIFY2(max_gap < 250, qPrintable(QString("event loop stalled for %1 ms").arg(max_gap)));
+    QVERIFY(call_time.elapsed() >= 900);
+}
+
+void tst_MQTTHandler::callsDoNotBlockWithoutBroker()
+{
+    broker->close();
+
+    QElapsedTimer call_time;
+    call_time.start();
+    QVERIFY(handler->connectToHost("127.0.0.1", broker->port()));
+    handler->publish("devices/lamp/set", "{\"state\":\"ON\"}");
+    handler->queuePublish("devices/lamp/set", "{\"state\":\"OFF\"}");
+    handler->addSubscription("devices/#");
+    QVERIFY(call_time.elapsed() < 100);
+    QVERIFY(!handler->isConnected());
+}
+
+void tst_MQTTHandler::recoversFromFlappingBroker()
+{
+    handler->setReconnectBackoff(100, 200);
+    QVERIFY(connectHandler());
+
+    // Overlapping filters collapse to the two broadest before they reach the broker
+    const QStringList filters = {"devices/#", "devices/+/state", "devices/lamp/state",
+                                 "zigbee2mqtt/bridge/state"};
+    for (const QString& filter : filters) {
+        handler->addSubscription(filter);
+    }
+    QTRY_COMPARE_WITH_TIMEOUT(broker->subscriptions(),
+                              QStringList() << "devices/#" << "zigbee2mqtt/bridge/state", 5000);
+
+    QSignalSpy recovered(handler.get(), &MQTTHandler::connectionRecovered);
+    const int flaps = 3;
+    for (int flap = 1; flap <= flaps; flap++) {
+        broker->resetCounters();
+        broker->close();
+        QTRY_VERIFY_WITH_TIMEOUT(!handler->isConnected(), 5000);
+        QTest::qWait(300);
+        QVERIFY(broker->listen());
+
+        QTRY_COMPARE_WITH_TIMEOUT(recovered.count(), flap, 5000);
+        QTRY_VERIFY_WITH_TIMEOUT(handler->isConnected(), 5000);
+
+        // The outage is measured from the drop to the new CONNACK
+        const MQTTHandler::ConnectionStats stats = handler->connectionStats();
+        QCOMPARE(stats.state, MQTTConnection::Online);
+        QCOMPARE(stats.recoveries, static_cast<quint64>(flap));
+        QVERIFY2(stats.last_recovery_ms >= 250, qPrintable(QString("outage %1 ms").arg(stats.last_recovery_ms)));
+        QCOMPARE(recovered.last().at(0).toLongLong(), stats.last_recovery_ms);
+
+        // Subscriptions come back without a SUBSCRIBE per filter the managers asked for
+        QTRY_COMPARE_WITH_TIMEOUT(broker->subscriptions(),
+                                  QStringList() << "devices/#" << "zigbee2mqtt/bridge/state", 5000);
+        QVERIFY2(broker->subscribePackets() <= 2,
+                 qPrintable(QString("%1 SUBSCRIBE packets").arg(broker->subscribePackets())));
+    }
+
+    // And traffic flows again both ways
+    QByteArray delivered;
+    connect(handler.get(), &MQTTHandler::messageReceived, this,
+            [&delivered](TopicId, const QString& topic, const QByteArray& payload) {
+        if (topic == "devices/lamp/state") {
+            delivered = payload;
+        }
+    });
+    broker->publish("devices/lamp/state", "back");
+    QTRY_COMPARE_WITH_TIMEOUT(delivered, QByteArray("back"), 5000);
+
+    QSignalSpy published(broker.get(), &MQTTBrokerStandIn::published);
+    handler->publish("devices/lamp/set", "{\"state\":\"ON\"}");
+    QTRY_COMPARE_WITH_TIMEOUT(published.count(), 1, 5000);
+}
+
+void tst_MQTTHandler::throttledBrokerKeepsMemoryBounded()
+{
+    const qint64 high_bytes = 64 * 1024;
+    handler->setBackpressureWatermarks(high_bytes, 16 * 1024);
+    QVERIFY(connectHandler());
+    broker->setBandwidthLimit(32 * 1024);
+
+    // Paused and resumed by backpressure, as DeviceManager::onBackpressureChanged does for Mosquitto devices
+    MQTTRGBDevice::LightInfo info;
+    info.name = "Desk Strip";
+    info.unique_id = "desk_strip";
+    info.command_topic = "devices/desk_strip/set";
+    info.num_leds = 1;
+    info.has_brightness = false;
+    info.has_rgb = true;
+    info.has_effects = false;
+    MosquittoLightDevice device(info);
+    connect(handler.get(), &MQTTHandler::backpressureChanged, &device, &MQTTRGBDevice::SetStreamingPaused);
+    int device_frames = 0;
+    connect(&device, &MQTTRGBDevice::mqttPublishNeeded, this,
+            [&](const QString& topic, const QByteArray& payload, const PublishOptions& options) {
+        device_frames++;
+        handler->queuePublish(topic, payload, options);
+    });
+
+    QSignalSpy backpressure(handler.get(), &MQTTHandler::backpressureChanged);
+
+    // Effect frames offered at about 2 MB/s to a broker reading 32 KB/s
+    const int topics = 32;
+    const QByteArray padding(1024, 'x');
+    PublishOptions streaming;
+    streaming.delivery = PublishOptions::Streaming;
+    streaming.lane = PublishOptions::StreamingLane;
+
+    qint64 offered_bytes = 0;
+    qint64 max_backlog = 0;
+    int max_pending = 0;
+    int paused_updates = 0;
+    int paused_frames = 0;
+    bool last_update_paused = false;
+    int transitions_at_last_update = 0;
+    QElapsedTimer clock;
+    clock.start();
+    for (quint32 frame = 0; clock.elapsed() < 4000; frame++) {
+        for (int t = 0; t < topics; t++) {
+            const QByteArray payload = QByteArray::number(frame) + padding;
+            handler->queuePublish(QString("devices/%1/set").arg(t), payload, streaming);
+            offered_bytes += payload.size();
+        }
+
+        const bool paused = handler->isBackpressured();
+        const int frames_before = device_frames;
+        device.colors[0] = static_cast<RGBColor>(frame & 0xFFFFFF);
+        device.DeviceUpdateLEDs();
+        if (paused) {
+            paused_updates++;
+            paused_frames += device_frames - frames_before;
+        }
+        last_update_paused = paused;
+        transitions_at_last_update = backpressure.count();
+
+        QTest::qWait(5);
+        const MQTTHandler::PublishStats stats = handler->publishStats();
+        max_backlog = qMax(max_backlog, stats.transport_backlog);
+        max_pending = qMax(max_pending, stats.pending);
+    }
+
+    const MQTTHandler::PublishStats stats = handler->publishStats();
+    QVERIFY(!backpressure.isEmpty());
+    QCOMPARE(backpressure.first().at(0).toBool(), true);
+    QVERIFY(stats.throttled > 0);
+
+    // Held frames are merged per topic, and the socket stops growing about one flush past the mark
+    const qint64 flush_bytes = (topics + 1) * (padding.size() + 64);
+    QVERIFY2(max_pending <= topics + 1, qPrintable(QString("%1 publishes pending").arg(max_pending)));
+    QVERIFY2(max_backlog <= high_bytes + 2 * flush_bytes,
+             qPrintable(QString("%1 bytes unsent").arg(max_backlog)));
+    QVERIFY(offered_bytes > 10 * (high_bytes + 2 * flush_bytes));
+
+    // The device skipped its frames while the transport was backpressured
+    QVERIFY(paused_updates > 0);
+    QCOMPARE(paused_frames, 0);
+
+    // Once the broker keeps up again the backlog drains, and a device that skipped its
+    // latest frame sends it once. The pause may already have lifted and come back during
+    // the run, in which case that catch-up frame has gone out already.
+    const bool catch_up_due = last_update_paused && backpressure.count() == transitions_at_last_update;
+    const int frames_before_release = device_frames;
+    broker->setBandwidthLimit(0);
+    QTRY_VERIFY_WITH_TIMEOUT(!handler->isBackpressured(), 10000);
+    QCOMPARE(backpressure.last().at(0).toBool(), false);
+    QCOMPARE(device_frames, frames_before_release + (catch_up_due ? 1 : 0));
+    QTRY_COMPARE_WITH_TIMEOUT(handler->publishStats().pending, 0, 5000);
+}
+
+void tst_MQTTHandler::backpressureClearsWithNothingPending()
+{
+    const qint64 high_bytes = 64 * 1024;
+    handler->setBackpressureWatermarks(high_bytes, 16 * 1024);
+    QVERIFY(connectHandler());
+    broker->setBandwidthLimit(32 * 1024);
+
+    // Direct publishes skip the pending lanes, so they fill the socket without arming the flush timer
+    const QByteArray payload(8 * 1024, 'x');
+    for (int i = 0; i < 1000; i++) {
+        handler->publish(QString("devices/%1/set").arg(i % 32), payload);
+    }
+    QTRY_VERIFY_WITH_TIMEOUT(handler->publishStats().transport_backlog > high_bytes, 10000);
+
+    // One final state runs a flush, which turns backpressure on and sends it, leaving nothing pending
+    QSignalSpy backpressure(handler.get(), &MQTTHandler::backpressureChanged);
+    PublishOptions final_state;
+    final_state.delivery = PublishOptions::Final;
+    handler->queuePublish("devices/lamp/set", "{\"state\":\"ON\"}", final_state);
+    QTRY_COMPARE_WITH_TIMEOUT(backpressure.count(), 1, 5000);
+    QCOMPARE(backpressure.first().at(0).toBool(), true);
+    QTRY_COMPARE_WITH_TIMEOUT(handler->publishStats().pending, 0, 5000);
+
+    // With no further publishes, the pause still has to lift once the socket drains
+    broker->setBandwidthLimit(0);
+    QTRY_COMPARE_WITH_TIMEOUT(backpressure.count(), 2, 10000);
+    QCOMPARE(backpressure.last().at(0).toBool(), false);
+    QVERIFY(!handler->isBackpressured());
+}
+
+QTEST_MAIN(tst_MQTTHandler)
+#include "tst_mqtthandler.moc"
@@ -0,0 +1,97 @@
+#include <QtTest>
+#include "mqtt/TopicAliasTable.h"
+
+class tst_TopicAliasTable : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void disabledWithoutAliases();
+    void promotedAfterRepeatedPublishes();
+    void hotterTopicTakesColdestAlias();
+    void resetForgetsEverything();
+
+private:
+    static quint16 publish(TopicAliasTable& table, const QString& topic, int times, bool* remapped = nullptr);
+};
+
+quint16 tst_TopicAliasTable::publish(TopicAliasTable& table, const QString& topic, int times, bool* remapped)
+{
+    quint16 alias = 0;
+    bool last_remapped = false;
+    for (int i = 0; i < times; i++) {
+        alias = table.aliasFor(topic, last_remapped);
+    }
+    if (remapped)
+        *remapped = last_remapped;
+    return alias;
+}
+
+void tst_TopicAliasTable::disabledWithoutAliases()
+{
+    TopicAliasTable table;
+    QCOMPARE(table.capacity(), quint16(0));
+    QCOMPARE(publish(table, "a", 100), quint16(0));
+
+    table.reset(0);
+    QCOMPARE(publish(table, "a", 100), quint16(0));
+}
+
+void tst_TopicAliasTable::promotedAfterRepeatedPublishes()
+{
+    TopicAliasTable table;
+    table.reset(4);
+    QCOMPARE(table.capacity(), quint16(4));
+
+    // One-off topics never spend an alias
+    bool remapped = true;
+    QCOMPARE(publish(table, "zigbee2mqtt/lamp/set", 2, &remapped), quint16(0));
+    QVERIFY(!remapped);
+
+    // The publish that earns the alias carries the topic with it
+    QCOMPARE(publish(table, "zigbee2mqtt/lamp/set", 1, &remapped), quint16(1));
+    QVERIFY(remapped);
+
+    // After that the alias alone
+    QCOMPARE(publish(table, "zigbee2mqtt/lamp/set", 1, &remapped), quint16(1));
+    QVERIFY(!remapped);
+
+    QCOMPARE(publish(table, "zigbee2mqtt/strip/set", 3, &remapped), quint16(2));
+    QVERIFY(remapped);
+}
+
+void tst_TopicAliasTable::hotterTopicTakesColdestAlias()
+{
+    TopicAliasTable table;
+    table.reset(2);
+    QCOMPARE(publish(table, "a", 3), quint16(1));
+    QCOMPARE(publish(table, "b", 5), quint16(2));
+
+    // Full table: a newcomer needs more than twice the coldest topic's hits
+    QCOMPARE(publish(table, "c", 6), quint16(0));
+    bool remapped = false;
+    QCOMPARE(publish(table, "c", 1, &remapped), quint16(1));
+    QVERIFY(remapped);
+
+    // "a" lost its alias and is not hot enough to take one back
+    QCOMPARE(publish(table, "a", 1), quint16(0));
+    QCOMPARE(publish(table, "b", 1), quint16(2));
+}
+
+void tst_TopicAliasTable::resetForgetsEverything()
+{
+    TopicAliasTable table;
+    table.reset(2);
+    QCOMPARE(publish(table, "a", 3), quint16(1));
+
+    // A new connection starts with no aliases and no history
+    table.reset(2);
+    bool remapped = true;
+    QCOMPARE(publish(table, "a", 1, &remapped), quint16(0));
+    QVERIFY(!remapped);
+    QCOMPARE(publish(table, "a", 2, &remapped), quint16(1));
+    QVERIFY(remapped);
+}
+
+QTEST_APPLESS_MAIN(tst_TopicAliasTable)
+#include "tst_topicaliastable.moc"
@@ -0,0 +1,7 @@
+include(../../harness/harness.pri)
+
+QT += testlib
+CONFIG += testcase
+TARGET = tst_topictable
+
+SOURCES += tst_topictable.cpp
@@ -0,0 +1,96 @@
+#include <QtTest>
+#include <QSet>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+#include "mqtt/TopicTable.h"
+
+class tst_TopicTable : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void sameTopicSameId();
+    void idsAreDenseFromOne();
+    void fullTableHandsOutInvalid();
+    void threadsAgreeOnIds();
+};
+
+void tst_TopicTable::sameTopicSameId()
+{
+    TopicTable table;
+    const TopicId id = table.intern("zigbee2mqtt/Desk Lamp");
+    QVERIFY(id != INVALID_TOPIC_ID);
+
+    // A separately built string with the same text is the same topic
+    QCOMPARE(table.intern(QString("zigbee2mqtt/") + "Desk Lamp"), id);
+    QVERIFY(table.intern("zigbee2mqtt/Desk Lamp/availability") != id);
+}
+
+void tst_TopicTable::idsAreDenseFromOne()
+{
+    TopicTable table;
+    for (int i = 0; i < 100; i++) {
+        QCOMPARE(table.intern(QString("devices/%1/state").arg(i)), static_cast<TopicId>(i + 1));
+    }
+    QCOMPARE(table.intern("devices/42/state"), static_cast<TopicId>(43));
+}
+
+void tst_TopicTable::fullTableHandsOutInvalid()
+{
+    TopicTable table(3);
+    QCOMPARE(table.intern("a"), static_cast<TopicId>(1));
+    QCOMPARE(table.intern("b"), static_cast<TopicId>(2));
+    QCOMPARE(table.intern("c"), static_cast<TopicId>(3));
+
+    // New topics fall back to the string path; known ones keep their ids
+    QCOMPARE(table.intern("d"), INVALID_TOPIC_ID);
+    QCOMPARE(table.intern("e"), INVALID_TOPIC_ID);
+    QCOMPARE(table.intern("a"), static_cast<TopicId>(1));
+    QCOMPARE(table.intern("c"), static_cast<TopicId>(3));
+}
+
+void tst_TopicTable::threadsAgreeOnIds()
+{
+    const int topic_count = 2000;
+    const int thread_count = 4;
+
+    QStringList topics;
+    for (int i = 0; i < topic_count; i++) {
+        topics << QString("homeassistant/light/node_%1/config").arg(i);
+    }
+
+    // Every thread interns every topic, each in its own order
+    TopicTable table;
+    std::vector<std::vector<TopicId>> seen(thread_count, std::vector<TopicId>(topic_count));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; t++) {
+        threads.emplace_back([&, t]() {
+            std::vector<int> order(topic_count);
+            std::iota(order.begin(), order.end(), 0);
+            std::shuffle(order.begin(), order.end(), std::mt19937(t));
+            for (int i : order) {
+                seen[t][i] = table.intern(topics[i]);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    QSet<TopicId> ids;
+    for (int i = 0; i < topic_count; i++) {
+        const TopicId id = seen[0][i];
+        QVERIFY(id >= 1 && id <= static_cast<TopicId>(topic_count));
+        for (int t = 1; t < thread_count; t++) {
+            QCOMPARE(seen[t][i], id);
+        }
+        ids.insert(id);
+    }
+    QCOMPARE(ids.size(), topic_count);
+}
+
+QTEST_APPLESS_MAIN(tst_TopicTable)
+#include "tst_topictable.moc"
@@ -0,0 +1,138 @@
+#include <QtTest>
+#include "mqtt/TopicTrie.h"
+#include "MQTTBrokerStandIn.h"
+
+class tst_TopicTrie : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void matchesLikeABroker_data();
+    void matchesLikeABroker();
+    void invalidFilterRejected();
+    void everyMatchingHandlerRuns();
+    void removeStopsDispatch();
+    void dispatchByIdFollowsRouteChanges();
+    void handlerMayChangeRoutes();
+};
+
+void tst_TopicTrie::matchesLikeABroker_data()
+{
+    QTest::addColumn<QString>("filter");
+    QTest::addColumn<QString>("topic");
+
+    const char* filters[] = {"a/b/c", "a/+/c", "a/+", "a/#", "#", "+/#", "+/+", "$SYS/#", "a//c", "+"};
+    const char* topics[] = {"a", "a/b", "a/b/c", "a/b/d", "a//c", "b/c", "$SYS/uptime", "$SYS", "a/b/c/d"};
+    for (const char* filter : filters) {
+        for (const char* topic : topics) {
+            QTest::newRow(qPrintable(QString("%1 ~ %2").arg(filter, topic))) << QString(filter) << QString(topic);
+        }
+    }
+}
+
+void tst_TopicTrie::matchesLikeABroker()
+{
+    QFETCH(QString, filter);
+    QFETCH(QString, topic);
+
+    // The stand-in's plain level-by-level comparison is the reference
+    TopicTrie trie;
+    QVERIFY(trie.insert(filter, [](const QString&, const QByteArray&) {}) >= 0);
+    QCOMPARE(trie.matches(topic), MQTTBrokerStandIn::topicMatches(filter, topic));
+}
+
+void tst_TopicTrie::invalidFilterRejected()
+{
+    TopicTrie trie;
+    QCOMPARE(trie.insert("a/#/b", [](const QString&, const QByteArray&) {}), -1);
+    QCOMPARE(trie.size(), 0);
+    QVERIFY(!trie.matches("a/x/b"));
+}
+
+void tst_TopicTrie::everyMatchingHandlerRuns()
+{
+    TopicTrie trie;
+    QStringList calls;
+    trie.insert("zigbee2mqtt/lamp", [&calls](const QString&, const QByteArray&) { calls << "exact"; });
+    trie.insert("zigbee2mqtt/+", [&calls](const QString&, const QByteArray&) { calls << "plus"; });
+    trie.insert("zigbee2mqtt/#", [&calls](const QString&, const QByteArray&) { calls << "hash"; });
+    trie.insert("homeassistant/#", [&calls](const QString&, const QByteArray&) { calls << "other"; });
+
+    QByteArray seen_payload;
+    trie.insert("zigbee2mqtt/lamp", [&seen_payload](const QString& topic, const QByteArray& payload) {
+        QCOMPARE(topic, QString("zigbee2mqtt/lamp"));
+        seen_payload = payload;
+    });
+
+    QVERIFY(trie.dispatch("zigbee2mqtt/lamp", "{}"));
+    calls.sort();
+    QCOMPARE(calls, QStringList() << "exact" << "hash" << "plus");
+    QCOMPARE(seen_payload, QByteArray("{}"));
+
+    QVERIFY(!trie.dispatch("tasmota/lamp", "{}"));
+}
+
+void tst_TopicTrie::removeStopsDispatch()
+{
+    TopicTrie trie;
+    int calls = 0;
+    const int id = trie.insert("a/+", [&calls](const QString&, const QByteArray&) { calls++; });
+    QCOMPARE(trie.size(), 1);
+
+    QVERIFY(trie.dispatch("a/b", QByteArray()));
+    trie.remove(id);
+    QCOMPARE(trie.size(), 0);
+    QVERIFY(!trie.dispatch("a/b", QByteArray()));
+    QCOMPARE(calls, 1);
+
+    // Removing twice, or an id never handed out, is harmless
+    trie.remove(id);
+    trie.remove(12345);
+}
+
+void tst_TopicTrie::dispatchByIdFollowsRouteChanges()
+{
+    TopicTrie trie;
+    const TopicId id = 7;
+    int first = 0;
+    int second = 0;
+
+    trie.insert("a/+", [&first](const QString&, const QByteArray&) { first++; });
+    QVERIFY(trie.dispatch(id, "a/b", QByteArray()));
+    QVERIFY(trie.dispatch(id, "a/b", QByteArray()));
+    QCOMPARE(first, 2);
+
+    // A new route must not be hidden by the cached match
+    const int route = trie.insert("a/b", [&second](const QString&, const QByteArray&) { second++; });
+    QVERIFY(trie.dispatch(id, "a/b", QByteArray()));
+    QCOMPARE(first, 3);
+    QCOMPARE(second, 1);
+
+    trie.remove(route);
+    QVERIFY(trie.dispatch(id, "a/b", QByteArray()));
+    QCOMPARE(second, 1);
+
+    // The invalid id goes through the string path
+    QVERIFY(trie.dispatch(INVALID_TOPIC_ID, "a/c", QByteArray()));
+    QCOMPARE(first, 5);
+}
+
+void tst_TopicTrie::handlerMayChangeRoutes()
+{
+    TopicTrie trie;
+    int added_calls = 0;
+    int route = -1;
+    route = trie.insert("devices/+", [&](const QString& topic, const QByteArray&) {
+        // Like a manager registering a device's state route from its discovery handler
+        trie.insert(topic + "/state", [&added_calls](const QString&, const QByteArray&) { added_calls++; });
+        trie.remove(route);
+    });
+
+    QVERIFY(trie.dispatch(1, "devices/lamp", QByteArray()));
+    QVERIFY(!trie.dispatch(1, "devices/lamp", QByteArray()));
+    QVERIFY(trie.dispatch(2, "devices/lamp/state", QByteArray()));
+    QCOMPARE(added_calls, 1);
+}
+
+QTEST_APPLESS_MAIN(tst_TopicTrie)
+#include "tst_topictrie.moc"
@@ -0,0 +1,12 @@
+# Run with make benchmark. The end-to-end benchmarks print one JSON line per result;
+# the Qt Test microbenchmarks take -csv or -o <file>,xml for machine-readable output.
+TEMPLATE = subdirs
+
+SUBDIRS = \
+    connectionpool \
+    discoveryburst \
+    endtoend \
+    ingest \
+    publishoverhead \
+    topicalias \
+    topictrie
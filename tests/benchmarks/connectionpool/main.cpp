@@ -0,0 +1,146 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QTest>
+#include <QTimer>
+#include "MQTTBrokerStandIn.h"
+#include "BenchmarkReport.h"
+#include "mqtt/MQTTHandler.h"
+
+/*---------------------------------------------------------*\
+| Connection pool benchmark                                 |
+|                                                           |
+| Outbound throughput with publishes sharded over 1, 2, 4   |
+| and 8 broker connections. The broker stand-in reads each  |
+| socket at a capped rate, the way a slow link or a busy    |
+| broker would, so one connection is the bottleneck that    |
+| sharding is meant to remove. Also checks that every       |
+| topic's frames still arrive in order.                     |
+|                                                           |
+|   bench_connectionpool [--pools 1,2,4,8] [--messages      |
+|                        20000] [--devices 64] [--payload   |
+|                        128] [--bandwidth 1048576]         |
+\*---------------------------------------------------------*/
+
+namespace {
+    // Publishes allowed ahead of the broker, so a slow run doesn't just fill memory
+    const quint64 WINDOW = 2000;
+
+    QJsonObject run(MQTTBrokerStandIn& broker, int pool_size, quint64 total, int devices, int payload_size)
+    {
+        MQTTHandler handler;
+        handler.setConnectionPoolSize(pool_size);
+        handler.connectToHost("127.0.0.1", broker.port());
+        if (!QTest::qWaitFor([&]() { return handler.isConnected() && broker.clientCount() == pool_size; }, 5000)) {
+            qCritical("Connection pool of %d did not connect", pool_size);
+            return QJsonObject();
+        }
+
+        LatencyHistogram histogram;
+        quint64 received = 0;
+        quint64 reordered = 0;
+        QHash<QString, quint64> last_sequence;
+        const QMetaObject::Connection receiver = QObject::connect(&broker, &MQTTBrokerStandIn::published,
+                [&](const QString& topic, const QByteArray& payload, qint64 received_ns, int) {
+            // "<sent_ns> <sequence> <padding>"
+            const QList<QByteArray> fields = payload.split(' ');
+            if (fields.size() < 2)
+                return;
+            histogram.record(received_ns - fields[0].toLongLong());
+
+            const quint64 sequence = fields[1].toULongLong();
+            auto last = last_sequence.find(topic);
+            if (last != last_sequence.end() && sequence < last.value())
+                reordered++;
+            last_sequence[topic] = sequence;
+            received++;
+        });
+
+        QStringList topics;
+        for (int i = 0; i < devices; i++) {
+            topics << QString("openrgb/bench/device_%1/set").arg(i);
+        }
+
+        const QByteArray padding(payload_size, 'x');
+        quint64 sent = 0;
+        QTimer feeder;
+        feeder.setTimerType(Qt::PreciseTimer);
+        feeder.setInterval(1);
+        QObject::connect(&feeder, &QTimer::timeout, [&]() {
+            for (; sent < total && sent < received + WINDOW; sent++) {
+                handler.publish(topics[static_cast<int>(sent % devices)],
+                                QByteArray::number(Latency::nowNs()) + ' ' + QByteArray::number(sent) + ' ' + padding);
+            }
+            if (sent >= total)
+                feeder.stop();
+        });
+
+        broker.resetCounters();
+        const qint64 cpu_start = BenchmarkReport::cpuTimeNs();
+        QElapsedTimer wall;
+        wall.start();
+        feeder.start();
+        QTest::qWaitFor([&]() { return received >= total; }, 120000);
+        const qint64 wall_ns = qMax<qint64>(1, wall.nsecsElapsed());
+        const qint64 cpu_ns = BenchmarkReport::cpuTimeNs() - cpu_start;
+        feeder.stop();
+        QObject::disconnect(receiver);
+
+        QJsonObject result;
+        result["connections"] = pool_size;
+        result["devices"] = devices;
+        result["payload_bytes"] = payload_size;
+        result["sent"] = static_cast<double>(sent);
+        result["received"] = static_cast<double>(received);
+        result["reordered"] = static_cast<double>(reordered);
+        result["wire_bytes"] = static_cast<double>(broker.bytesReceived());
+        result["throughput_per_s"] = received * 1e9 / wall_ns;
+        result["latency"] = BenchmarkReport::latency(histogram.snapshot());
+        result["cpu_us_per_msg"] = received > 0 ? cpu_ns / 1000.0 / received : 0.0;
+        return result;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    const QCommandLineOption pools_option("pools", "Comma-separated connection pool sizes.", "list", "1,2,4,8");
+    const QCommandLineOption messages_option("messages", "Publishes per pool size.", "n", "20000");
+    const QCommandLineOption devices_option("devices", "Command topics published round-robin.", "n", "64");
+    const QCommandLineOption payload_option("payload", "Padding bytes per payload.", "n", "128");
+    const QCommandLineOption bandwidth_option("bandwidth", "Bytes per second the broker reads from each connection, 0 for no cap.",
+                                              "bytes", "1048576");
+    parser.addOptions({pools_option, messages_option, devices_option, payload_option, bandwidth_option});
+    parser.process(app);
+
+    const quint64 total = static_cast<quint64>(qMax(1, parser.value(messages_option).toInt()));
+    const int devices = qMax(1, parser.value(devices_option).toInt());
+    const int payload_size = qMax(0, parser.value(payload_option).toInt());
+
+    MQTTBrokerStandIn broker;
+    broker.setBandwidthLimit(parser.value(bandwidth_option).toLongLong());
+    if (!broker.listen()) {
+        qCritical("Broker stand-in could not listen");
+        return 1;
+    }
+
+    int status = 0;
+    for (const QString& pool_text : parser.value(pools_option).split(',', Qt::SkipEmptyParts)) {
+        const int pool_size = qBound(1, pool_text.trimmed().toInt(), 64);
+        const QJsonObject result = run(broker, pool_size, total, devices, payload_size);
+        if (result.isEmpty())
+            return 1;
+        BenchmarkReport::write("connection_pool", result);
+
+        if (result["received"].toDouble() < total || result["reordered"].toDouble() > 0)
+            status = 1;
+
+        // Let the pool's connections go before the next size connects
+        QTest::qWaitFor([&broker]() { return broker.clientCount() == 0; }, 5000);
+    }
+    return status;
+}
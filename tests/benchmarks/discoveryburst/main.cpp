@@ -0,0 +1,166 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTest>
+#include <atomic>
+#include <cstdlib>
+#include "BenchmarkReport.h"
+#include "mqtt/TopicTable.h"
+#include "mqtt/TopicTrie.h"
+#include "devices/mosquitto/MosquittoDeviceManager.h"
+
+/*---------------------------------------------------------*\
+| Discovery burst benchmark                                 |
+|                                                           |
+| Replays what the broker sends right after a connect: one  |
+| retained Home Assistant discovery config per light, then  |
+| rounds of state updates, through the TopicTrie routes a   |
+| MosquittoDeviceManager registers. Each replay runs twice, |
+| once dispatching by topic string as before topics were    |
+| interned and once interning at ingress and dispatching by |
+| TopicId, and reports CPU time and heap allocations per    |
+| message for each.                                         |
+|                                                           |
+|   bench_discoveryburst [--devices 2000] [--rounds 10]     |
+\*---------------------------------------------------------*/
+
+namespace {
+    std::atomic<quint64> allocations{0};
+}
+
+#if defined(__GLIBC__)
+// Counts every heap allocation in the process, Qt containers and operator new included
+extern "C" {
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* ptr, size_t size);
+
+    void* malloc(size_t size) __THROW
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t count, size_t size) __THROW
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* ptr, size_t size) __THROW
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        return __libc_realloc(ptr, size);
+    }
+}
+const bool COUNTS_ALLOCATIONS = true;
+#else
+const bool COUNTS_ALLOCATIONS = false;
+#endif
+
+namespace {
+    struct Message {
+        QString topic;
+        QByteArray payload;
+    };
+
+    QJsonObject measure(const QString& mode, const QString& phase, int messages,
+                        const std::function<void()>& replay)
+    {
+        const quint64 allocations_start = allocations.load();
+        const qint64 cpu_start = BenchmarkReport::cpuTimeNs();
+        QElapsedTimer wall;
+        wall.start();
+        replay();
+        const qint64 wall_ns = wall.nsecsElapsed();
+        const qint64 cpu_ns = BenchmarkReport::cpuTimeNs() - cpu_start;
+        const quint64 allocated = allocations.load() - allocations_start;
+
+        QJsonObject result;
+        result["mode"] = mode;
+        result["phase"] = phase;
+        result["messages"] = messages;
+        result["wall_ms"] = wall_ns / 1e6;
+        result["cpu_us_per_msg"] = cpu_ns / 1000.0 / qMax(1, messages);
+        if (COUNTS_ALLOCATIONS)
+            result["allocs_per_msg"] = static_cast<double>(allocated) / qMax(1, messages);
+        return result;
+    }
+
+    void replay(bool interned, int devices, const std::vector<Message>& configs,
+                const std::vector<std::vector<Message>>& rounds)
+    {
+        const QString mode = interned ? "interned" : "string";
+
+        TopicTable table;
+        TopicTrie router;
+        MosquittoDeviceManager manager;
+        manager.registerRoutes(router);
+
+        auto dispatch = [&](const Message& message) {
+            if (interned)
+                router.dispatch(table.intern(message.topic), message.topic, message.payload);
+            else
+                router.dispatch(message.topic, message.payload);
+        };
+
+        // Configs are parsed on the manager's pool and merged once the burst goes quiet
+        BenchmarkReport::write("discovery_burst", measure(mode, "configs", static_cast<int>(configs.size()), [&]() {
+            for (const Message& message : configs) {
+                dispatch(message);
+            }
+            if (!QTest::qWaitFor([&]() { return static_cast<int>(manager.getDevices().size()) == devices; }, 30000))
+                qCritical("Only %d of %d devices discovered", static_cast<int>(manager.getDevices().size()), devices);
+        }));
+
+        int state_messages = 0;
+        for (const std::vector<Message>& round : rounds) {
+            state_messages += static_cast<int>(round.size());
+        }
+        BenchmarkReport::write("discovery_burst", measure(mode, "states", state_messages, [&]() {
+            for (const std::vector<Message>& round : rounds) {
+                for (const Message& message : round) {
+                    dispatch(message);
+                }
+            }
+        }));
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    const QCommandLineOption devices_option("devices", "Lights in the discovery burst.", "n", "2000");
+    const QCommandLineOption rounds_option("rounds", "State updates replayed per light.", "n", "10");
+    parser.addOptions({devices_option, rounds_option});
+    parser.process(app);
+
+    const int devices = qMax(1, parser.value(devices_option).toInt());
+    const int round_count = qMax(0, parser.value(rounds_option).toInt());
+
+    // Built up front so the replays only pay for routing and the manager's own work
+    std::vector<Message> configs;
+    std::vector<std::vector<Message>> rounds(round_count);
+    for (int i = 0; i < devices; i++) {
+        const QString node = QString("homeassistant/light/bench_light_%1").arg(i);
+        configs.push_back({node + "/config", QString(
+            "{\"~\":\"%1\",\"name\":\"Bench Light %2\",\"uniq_id\":\"bench_light_%2\","
+            "\"rgb_cmd_t\":\"~/rgb/set\",\"rgb_stat_t\":\"~/state\","
+            "\"rgb_cmd_tpl\":\"{{ red }},{{ green }},{{ blue }}\",\"rgb_val_tpl\":\"{{ value_json.rgb }}\","
+            "\"dev\":{\"name\":\"Bench Light %2\",\"ids\":[\"bench_light_%2\"]}}").arg(node).arg(i).toUtf8()});
+
+        // linkquality changes every round, so no update is skipped as a duplicate
+        for (int r = 0; r < round_count; r++) {
+            rounds[r].push_back({node + "/state", QString(
+                "{\"state\":\"ON\",\"brightness\":%1,\"color\":{\"r\":%2,\"g\":%3,\"b\":%4},\"linkquality\":%5}")
+                .arg(128 + r).arg(i % 256).arg((i * 7) % 256).arg((i * 13) % 256).arg(r).toUtf8()});
+        }
+    }
+
+    replay(false, devices, configs, rounds);
+    replay(true, devices, configs, rounds);
+    return 0;
+}
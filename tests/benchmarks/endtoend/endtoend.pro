@@ -0,0 +1,17 @@
+include(../../harness/harness.pri)
+
+QT += testlib
+CONFIG += testcase benchmark
+TARGET = bench_endtoend
+
+# Zigbee and DDP devices are not part of the plugin build yet, only of this benchmark
+HEADERS += \
+    $$OPENRGB2MQTT_ROOT/src/devices/zigbee/ZigbeeLightDevice.h \
+    $$OPENRGB2MQTT_ROOT/src/devices/ddp/DDPController.h \
+    $$OPENRGB2MQTT_ROOT/src/devices/ddp/DDPLightDevice.h
+
+SOURCES += \
+    main.cpp \
+    $$OPENRGB2MQTT_ROOT/src/devices/zigbee/ZigbeeLightDevice.cpp \
+    $$OPENRGB2MQTT_ROOT/src/devices/ddp/DDPController.cpp \
+    $$OPENRGB2MQTT_ROOT/src/devices/ddp/DDPLightDevice.cpp
@@ -0,0 +1,351 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QNetworkDatagram>
+#include <QTest>
+#include <QThread>
+#include <QTimer>
+#include <QUdpSocket>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "MQTTBrokerStandIn.h"
+#include "BenchmarkReport.h"
+#include "mqtt/MQTTHandler.h"
+#include "devices/mosquitto/MosquittoLightDevice.h"
+#include "devices/zigbee/ZigbeeLightDevice.h"
+#include "devices/ddp/DDPLightDevice.h"
+
+/*---------------------------------------------------------*\
+| End-to-end benchmark                                      |
+|                                                           |
+| Latency from a device's DeviceUpdateLEDs - the call       |
+| OpenRGB makes for every effect frame - to the frame's     |
+| bytes arriving on loopback, for MQTTRGBDevice,            |
+| ZigbeeLightDevice and DDPLightDevice. MQTT frames go      |
+| through MQTTHandler's outbound queue to the broker        |
+| stand-in, DDP frames straight to a UDP sink on DDP_PORT.  |
+| Both listen on their own thread, so a frame is timed when |
+| it comes off the socket, not when the device thread gets  |
+| round to reading it. Frames merged away by the outbound   |
+| queue never reach the wire and are counted as merged.     |
+| client_latency is the in-process histogram, which stops   |
+| when QMqttClient::publish returns.                        |
+|                                                           |
+|   bench_endtoend [--protocols mqtt,zigbee,ddp]            |
+|                  [--devices 1,16,64] [--fps 30,60]        |
+|                  [--seconds 5] [--leds 60] [--flush 16]   |
+\*---------------------------------------------------------*/
+
+namespace {
+    struct Wire {
+        MQTTBrokerStandIn* broker;
+        QUdpSocket* ddp_sink;
+    };
+
+    struct Source {
+        std::unique_ptr<RGBController> device;
+        quint32 sequence = 0;
+        qint64 frame_start_ns = 0;
+        std::deque<std::pair<QByteArray, qint64>> unmatched;    // MQTT payload -> frame start
+        QHash<quint32, qint64> ddp_frames;                      // DDP sequence -> frame start
+    };
+
+    // Spread consecutive frames over the color space so no two neighbours look alike,
+    // including after ZigbeeLightDevice's conversion to xy
+    RGBColor frameColor(quint32 sequence)
+    {
+        const unsigned char red = static_cast<unsigned char>(sequence * 67);
+        const unsigned char green = static_cast<unsigned char>(sequence * 131);
+        const unsigned char blue = static_cast<unsigned char>(sequence * 199 + 64);
+        return ToRGBColor(red, green, blue);
+    }
+
+    // LED 0 carries the device index and LED 1 the frame sequence, for the sink to read back
+    void stampDDPFrame(RGBController* device, int index, quint32 sequence)
+    {
+        const unsigned char index_low = static_cast<unsigned char>(index);
+        const unsigned char index_high = static_cast<unsigned char>(index >> 8);
+        const unsigned char zero = 0;
+        const unsigned char sequence_0 = static_cast<unsigned char>(sequence);
+        const unsigned char sequence_1 = static_cast<unsigned char>(sequence >> 8);
+        const unsigned char sequence_2 = static_cast<unsigned char>(sequence >> 16);
+        device->colors[0] = ToRGBColor(index_low, index_high, zero);
+        device->colors[1] = ToRGBColor(sequence_0, sequence_1, sequence_2);
+        for (size_t led = 2; led < device->colors.size(); led++) {
+            device->colors[led] = frameColor(sequence + static_cast<quint32>(led));
+        }
+    }
+
+    QJsonObject run(Wire& wire, const QString& protocol, int device_count, int fps,
+                    int seconds, int leds, int flush_ms)
+    {
+        const bool ddp = protocol == "ddp";
+
+        QObject context;        // Wire arrivals are handled here, on this thread
+        std::unique_ptr<MQTTHandler> handler;
+        std::vector<Source> sources(device_count);
+        LatencyHistogram histogram;
+        quint64 offered = 0;
+        quint64 on_wire = 0;
+        quint64 wire_bytes = 0;
+
+        QHash<QString, int> by_topic;
+
+        // Once the wire thread has run the fence, no arrival handler is still using our locals
+        QMetaObject::Connection arrivals;
+        auto stop_arrivals = [&wire, &arrivals]() {
+            QObject::disconnect(arrivals);
+            QMetaObject::invokeMethod(wire.broker, []() {}, Qt::BlockingQueuedConnection);
+        };
+
+        if (ddp) {
+            QUdpSocket* sink = wire.ddp_sink;
+            arrivals = QObject::connect(sink, &QUdpSocket::readyRead, sink, [sink, &context, &sources, &histogram, &on_wire, &wire_bytes]() {
+                while (sink->hasPendingDatagrams()) {
+                    const QByteArray data = sink->receiveDatagram().data();
+                    const qint64 arrived_ns = Latency::nowNs();
+
+                    // 10 byte header, then RGB triplets - status queries carry no pixels
+                    if (data.size() < 16 || data[2] != DDP_TYPE_RGB)
+                        continue;
+                    const int index = static_cast<quint8>(data[10]) | static_cast<quint8>(data[11]) << 8;
+                    const quint32 sequence = static_cast<quint8>(data[13]) | static_cast<quint8>(data[14]) << 8
+                                           | static_cast<quint8>(data[15]) << 16;
+                    const int bytes = data.size();
+
+                    QMetaObject::invokeMethod(&context, [&sources, &histogram, &on_wire, &wire_bytes,
+                                                         index, sequence, arrived_ns, bytes]() {
+                        if (index >= static_cast<int>(sources.size()))
+                            return;
+                        auto frame = sources[index].ddp_frames.find(sequence);
+                        if (frame == sources[index].ddp_frames.end())
+                            return;
+                        histogram.record(arrived_ns - frame.value());
+                        sources[index].ddp_frames.erase(frame);
+                        on_wire++;
+                        wire_bytes += bytes;
+                    }, Qt::QueuedConnection);
+                }
+            });
+        } else {
+            handler.reset(new MQTTHandler);
+            handler->setPublishFlushInterval(flush_ms);
+            handler->connectToHost("127.0.0.1", wire.broker->port());
+            if (!QTest::qWaitFor([&handler]() { return handler->isConnected(); }, 5000)) {
+                qCritical("MQTTHandler did not connect");
+                return QJsonObject();
+            }
+
+            // Queued over from the wire thread; received_ns was taken as the bytes were read
+            arrivals = QObject::connect(wire.broker, &MQTTBrokerStandIn::published, &context,
+                    [&](const QString& topic, const QByteArray& payload, qint64 received_ns, int bytes) {
+                auto index = by_topic.constFind(topic);
+                if (index == by_topic.constEnd())
+                    return;
+
+                // Frames ahead of this one were merged into it by the outbound queue
+                std::deque<std::pair<QByteArray, qint64>>& unmatched = sources[index.value()].unmatched;
+                while (!unmatched.empty()) {
+                    const std::pair<QByteArray, qint64> frame = std::move(unmatched.front());
+                    unmatched.pop_front();
+                    if (frame.first == payload) {
+                        histogram.record(received_ns - frame.second);
+                        on_wire++;
+                        wire_bytes += bytes;
+                        break;
+                    }
+                }
+            });
+        }
+
+        for (int i = 0; i < device_count; i++) {
+            Source& source = sources[i];
+            if (ddp) {
+                DDPLightDevice::DeviceInfo info;
+                info.name = QString("Bench Strip %1").arg(i);
+                info.ip_address = "127.0.0.1";
+                info.num_leds = leds;
+                info.device_type = "Bench";
+                DDPLightDevice* device = new DDPLightDevice(info);
+                source.device.reset(device);
+                if (!device->IsConnected()) {
+                    qCritical("DDP device %d could not open its socket", i);
+                    stop_arrivals();
+                    return QJsonObject();
+                }
+                continue;
+            }
+
+            MQTTRGBDevice::LightInfo info;
+            info.name = QString("Bench Light %1").arg(i);
+            info.unique_id = QString("bench_light_%1").arg(i);
+            info.command_topic = protocol == "zigbee" ? QString("zigbee2mqtt/Bench Light %1/set").arg(i)
+                                                      : QString("homeassistant/light/bench_light_%1/rgb/set").arg(i);
+            info.num_leds = 1;
+            info.has_brightness = false;
+            info.has_rgb = true;
+            info.has_effects = false;
+            by_topic.insert(info.command_topic, i);
+
+            // Same hand-off as the plugin's DeviceManager -> MQTTHandler connection
+            MQTTHandler* queue = handler.get();
+            auto forward = [&source, queue](const QString& topic, const QByteArray& payload, const PublishOptions& options) {
+                source.unmatched.emplace_back(payload, source.frame_start_ns);
+                queue->queuePublish(topic, payload, options);
+            };
+            if (protocol == "zigbee") {
+                ZigbeeLightDevice* device = new ZigbeeLightDevice(info);
+                QObject::connect(device, &ZigbeeLightDevice::mqttPublishNeeded, &context, forward);
+                source.device.reset(device);
+            } else {
+                MosquittoLightDevice* device = new MosquittoLightDevice(info);
+                QObject::connect(device, &MQTTRGBDevice::mqttPublishNeeded, &context, forward);
+                source.device.reset(device);
+            }
+        }
+
+        // Every device gets a frame on the same tick, like an OpenRGB effect
+        QElapsedTimer load_clock;
+        const quint64 frames_per_device = static_cast<quint64>(fps) * seconds;
+        quint64 frames_done = 0;
+        QTimer tick;
+        tick.setTimerType(Qt::PreciseTimer);
+        tick.setInterval(1);
+        QObject::connect(&tick, &QTimer::timeout, [&]() {
+            const quint64 due = qMin<quint64>(frames_per_device, fps * load_clock.nsecsElapsed() / 1000000000LL);
+            for (; frames_done < due; frames_done++) {
+                for (int i = 0; i < device_count; i++) {
+                    Source& source = sources[i];
+                    source.sequence++;
+                    if (ddp) {
+                        stampDDPFrame(source.device.get(), i, source.sequence);
+                    } else {
+                        source.device->colors[0] = frameColor(source.sequence);
+                    }
+
+                    source.frame_start_ns = Latency::nowNs();
+                    if (ddp)
+                        source.ddp_frames.insert(source.sequence & 0xFFFFFF, source.frame_start_ns);
+                    source.device->DeviceUpdateLEDs();
+                    offered++;
+                }
+            }
+            if (frames_done >= frames_per_device)
+                tick.stop();
+        });
+
+        Latency::reset();
+        const qint64 cpu_start = BenchmarkReport::cpuTimeNs();
+        load_clock.start();
+        tick.start();
+        QTest::qWaitFor([&tick]() { return !tick.isActive(); }, seconds * 1000 + 10000);
+        const qint64 load_ns = qMax<qint64>(1, load_clock.nsecsElapsed());
+
+        // Let the last flush tick and anything still on loopback arrive
+        QTest::qWait(flush_ms + 500);
+        const qint64 wall_ns = qMax<qint64>(1, load_clock.nsecsElapsed());
+        const qint64 cpu_ns = BenchmarkReport::cpuTimeNs() - cpu_start;
+        stop_arrivals();
+
+        QJsonObject result;
+        result["protocol"] = protocol;
+        result["devices"] = device_count;
+        result["fps"] = fps;
+        result["seconds"] = seconds;
+        if (ddp) {
+            result["leds"] = leds;
+        } else {
+            result["flush_ms"] = flush_ms;
+        }
+        result["frames_offered"] = static_cast<double>(offered);
+        result["frames_on_wire"] = static_cast<double>(on_wire);
+        result["frames_merged"] = static_cast<double>(offered - on_wire);
+        result["throughput_per_s"] = on_wire * 1e9 / load_ns;
+        result["wire_bytes_per_s"] = wire_bytes * 1e9 / load_ns;
+        result["latency"] = BenchmarkReport::latency(histogram.snapshot());
+        if (!ddp) {
+            // The "mqtt" run drives MosquittoLightDevice, which records under its own protocol name
+            const QString device_protocol = protocol == "zigbee" ? protocol : QString("mosquitto");
+            result["client_latency"] = BenchmarkReport::latency(Latency::forProtocol(device_protocol)->snapshot());
+        }
+        result["cpu_pct"] = 100.0 * cpu_ns / wall_ns;
+        return result;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    const QCommandLineOption protocols_option("protocols", "Comma-separated protocols: mqtt, zigbee, ddp.", "list", "mqtt,zigbee,ddp");
+    const QCommandLineOption devices_option("devices", "Comma-separated device counts.", "list", "1,16,64");
+    const QCommandLineOption fps_option("fps", "Comma-separated frames per second per device.", "list", "30,60");
+    const QCommandLineOption seconds_option("seconds", "Length of each run.", "s", "5");
+    const QCommandLineOption leds_option("leds", "LEDs per DDP device.", "n", "60");
+    const QCommandLineOption flush_option("flush", "MQTTHandler publish flush interval.", "ms", "16");
+    parser.addOptions({protocols_option, devices_option, fps_option, seconds_option, leds_option, flush_option});
+    parser.process(app);
+
+    const int seconds = qMax(1, parser.value(seconds_option).toInt());
+    const int leds = qBound(2, parser.value(leds_option).toInt(), 480);
+    const int flush_ms = qMax(0, parser.value(flush_option).toInt());
+
+    // The broker stand-in and the DDP sink get a thread of their own
+    QThread wire_thread;
+    wire_thread.start();
+    Wire wire = {new MQTTBrokerStandIn, new QUdpSocket};
+    wire.broker->moveToThread(&wire_thread);
+    wire.ddp_sink->moveToThread(&wire_thread);
+    QObject::connect(&wire_thread, &QThread::finished, wire.broker, &QObject::deleteLater);
+    QObject::connect(&wire_thread, &QThread::finished, wire.ddp_sink, &QObject::deleteLater);
+
+    bool listening = false;
+    bool sink_bound = false;
+    QMetaObject::invokeMethod(wire.broker, [&wire, &listening, &sink_bound]() {
+        listening = wire.broker->listen();
+        sink_bound = wire.ddp_sink->bind(QHostAddress::LocalHost, DDP_PORT);
+    }, Qt::BlockingQueuedConnection);
+
+    int status = 0;
+    if (!listening) {
+        qCritical("Broker stand-in could not listen");
+        status = 1;
+    }
+
+    for (const QString& protocol_text : parser.value(protocols_option).split(',', Qt::SkipEmptyParts)) {
+        const QString protocol = protocol_text.trimmed();
+        if (protocol != "mqtt" && protocol != "zigbee" && protocol != "ddp") {
+            qCritical("Unknown protocol %s", qUtf8Printable(protocol));
+            status = 1;
+            continue;
+        }
+        if ((protocol == "ddp" && !sink_bound) || (protocol != "ddp" && !listening)) {
+            if (protocol == "ddp")
+                qCritical("DDP sink could not bind 127.0.0.1:%d", DDP_PORT);
+            status = 1;
+            continue;
+        }
+
+        for (const QString& devices_text : parser.value(devices_option).split(',', Qt::SkipEmptyParts)) {
+            for (const QString& fps_text : parser.value(fps_option).split(',', Qt::SkipEmptyParts)) {
+                const int devices = qBound(1, devices_text.trimmed().toInt(), 65535);
+                const int fps = qBound(1, fps_text.trimmed().toInt(), 1000);
+                const QJsonObject result = run(wire, protocol, devices, fps, seconds, leds, flush_ms);
+                if (result.isEmpty()) {
+                    status = 1;
+                    continue;
+                }
+                BenchmarkReport::write("end_to_end", result);
+            }
+        }
+    }
+
+    wire_thread.quit();
+    wire_thread.wait();
+    return status;
+}
@@ -0,0 +1,162 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTest>
+#include <QTimer>
+#include "MQTTBrokerStandIn.h"
+#include "BenchmarkReport.h"
+#include "mqtt/MQTTHandler.h"
+
+/*---------------------------------------------------------*\
+| Ingest benchmark                                          |
+|                                                           |
+| Latency from the broker writing a message to             |
+| MQTTHandler::messageReceived firing on the GUI thread,    |
+| at each of the given inbound rates, plus the process CPU  |
+| spent while connected with no traffic at all. A 1 ms      |
+| heartbeat on the GUI thread shows how long the event loop |
+| was kept away under load.                                 |
+|                                                           |
+|   bench_ingest [--rates 1000,5000] [--seconds 5]          |
+|                [--idle 2] [--payload 128]                 |
+\*---------------------------------------------------------*/
+
+namespace {
+    QJsonObject runLoad(MQTTBrokerStandIn& broker, MQTTHandler& handler,
+                        qint64 rate, int seconds, int payload_size)
+    {
+        const MQTTHandler::QueueStats before = handler.queueStats();
+
+        LatencyHistogram histogram;
+        quint64 received = 0;
+        const QMetaObject::Connection receiver = QObject::connect(&handler, &MQTTHandler::messageReceived,
+                [&histogram, &received](TopicId, const QString&, const QByteArray& payload) {
+            // The payload starts with the broker-side send time
+            const qint64 sent_ns = payload.left(payload.indexOf(' ')).toLongLong();
+            histogram.record(Latency::nowNs() - sent_ns);
+            received++;
+        });
+
+        // Longest the GUI thread went without running a 1 ms timer
+        qint64 last_beat_ns = Latency::nowNs();
+        qint64 max_stall_ns = 0;
+        QTimer heartbeat;
+        heartbeat.setTimerType(Qt::PreciseTimer);
+        heartbeat.setInterval(1);
+        QObject::connect(&heartbeat, &QTimer::timeout, [&last_beat_ns, &max_stall_ns]() {
+            const qint64 now = Latency::nowNs();
+            max_stall_ns = qMax(max_stall_ns, now - last_beat_ns);
+            last_beat_ns = now;
+        });
+
+        // A 1 ms tick publishes whatever the target rate says is due by now
+        const quint64 total = static_cast<quint64>(rate) * seconds;
+        const QByteArray padding(payload_size, 'x');
+        quint64 sent = 0;
+        QElapsedTimer load_clock;
+        QTimer tick;
+        tick.setTimerType(Qt::PreciseTimer);
+        tick.setInterval(1);
+        QObject::connect(&tick, &QTimer::timeout, [&]() {
+            const quint64 due = qMin<quint64>(total, rate * load_clock.nsecsElapsed() / 1000000000LL);
+            for (; sent < due; sent++) {
+                broker.publish(QString("bench/ingest/%1").arg(sent % 64),
+                               QByteArray::number(Latency::nowNs()) + ' ' + padding);
+            }
+            if (sent >= total)
+                tick.stop();
+        });
+
+        const qint64 cpu_start = BenchmarkReport::cpuTimeNs();
+        load_clock.start();
+        last_beat_ns = Latency::nowNs();
+        heartbeat.start();
+        tick.start();
+        QTest::qWaitFor([&]() {
+            return sent >= total && received + handler.queueStats().dropped - before.dropped >= total;
+        }, seconds * 1000 + 10000);
+        heartbeat.stop();
+        const qint64 wall_ns = qMax<qint64>(1, load_clock.nsecsElapsed());
+        const qint64 cpu_ns = BenchmarkReport::cpuTimeNs() - cpu_start;
+        QObject::disconnect(receiver);
+
+        const MQTTHandler::QueueStats after = handler.queueStats();
+
+        QJsonObject result;
+        result["rate_per_s"] = static_cast<double>(rate);
+        result["seconds"] = seconds;
+        result["payload_bytes"] = payload_size;
+        result["sent"] = static_cast<double>(sent);
+        result["received"] = static_cast<double>(received);
+        result["dropped"] = static_cast<double>(after.dropped - before.dropped);
+        result["queue_high_water"] = static_cast<double>(after.high_water);
+        result["throughput_per_s"] = received * 1e9 / wall_ns;
+        result["latency"] = BenchmarkReport::latency(histogram.snapshot());
+        result["gui_max_stall_ms"] = max_stall_ns / 1e6;
+        result["cpu_us_per_msg"] = received > 0 ? cpu_ns / 1000.0 / received : 0.0;
+        return result;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    const QCommandLineOption rates_option("rates", "Comma-separated inbound messages per second.", "list", "1000,5000");
+    const QCommandLineOption seconds_option("seconds", "Length of each loaded run.", "s", "5");
+    const QCommandLineOption idle_option("idle", "Length of the idle run.", "s", "2");
+    const QCommandLineOption payload_option("payload", "Payload size in bytes.", "n", "128");
+    parser.addOptions({rates_option, seconds_option, idle_option, payload_option});
+    parser.process(app);
+
+    const int seconds = qMax(1, parser.value(seconds_option).toInt());
+    const int idle_seconds = qMax(0, parser.value(idle_option).toInt());
+    const int payload_size = qMax(0, parser.value(payload_option).toInt());
+
+    MQTTBrokerStandIn broker;
+    if (!broker.listen()) {
+        qCritical("Broker stand-in could not listen");
+        return 1;
+    }
+
+    MQTTHandler handler;
+    handler.connectToHost("127.0.0.1", broker.port());
+    if (!QTest::qWaitFor([&handler]() { return handler.isConnected(); }, 5000)) {
+        qCritical("MQTTHandler did not connect");
+        return 1;
+    }
+
+    const QString filter = "bench/ingest/#";
+    handler.addSubscription(filter);
+    if (!QTest::qWaitFor([&broker, &filter]() { return broker.subscriptions().contains(filter); }, 5000)) {
+        qCritical("Subscription did not reach the broker");
+        return 1;
+    }
+
+    // Connected and idle - nothing should be waking up
+    if (idle_seconds > 0) {
+        QElapsedTimer wall;
+        wall.start();
+        const qint64 cpu_start = BenchmarkReport::cpuTimeNs();
+        QTest::qWait(idle_seconds * 1000);
+        const qint64 cpu_ns = BenchmarkReport::cpuTimeNs() - cpu_start;
+
+        QJsonObject idle;
+        idle["seconds"] = idle_seconds;
+        idle["cpu_pct"] = 100.0 * cpu_ns / qMax<qint64>(1, wall.nsecsElapsed());
+        BenchmarkReport::write("ingest_idle", idle);
+    }
+
+    int status = 0;
+    for (const QString& rate_text : parser.value(rates_option).split(',', Qt::SkipEmptyParts)) {
+        const qint64 rate = qMax(1, rate_text.trimmed().toInt());
+        const QJsonObject result = runLoad(broker, handler, rate, seconds, payload_size);
+        BenchmarkReport::write("ingest", result);
+
+        if (result["received"].toDouble() + result["dropped"].toDouble() < result["sent"].toDouble())
+            status = 1;
+    }
+    return status;
+}
@@ -0,0 +1,114 @@
+#include <QtTest>
+#include <string>
+#include "devices/mosquitto/MosquittoLightDevice.h"
+
+/*---------------------------------------------------------*\
+| bench_PublishOverhead                                     |
+|                                                           |
+| Per-publish topic handling: the command topic rebuilt and |
+| validated for every frame, as ZigbeeLightDevice and       |
+| MQTTConnection used to, next to the QMqttTopicName a      |
+| device builds once. deviceFrame is a whole color frame    |
+| from DeviceUpdateLEDs to the mqttPublishNeeded emission.  |
+| Run with -csv or -o file,xml for machine output.          |
+\*---------------------------------------------------------*/
+
+class bench_PublishOverhead : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void rebuiltTopic_data();
+    void rebuiltTopic();
+    void cachedTopic_data();
+    void cachedTopic();
+    void deviceFrame();
+
+private:
+    void addRows();
+};
+
+void bench_PublishOverhead::addRows()
+{
+    QTest::addColumn<QString>("name");
+    QTest::newRow("short") << QString("Lamp");
+    QTest::newRow("long") << QString("Living Room Ceiling Light Left 0x00158d0001a2b3c4");
+}
+
+void bench_PublishOverhead::rebuiltTopic_data()
+{
+    addRows();
+}
+
+void bench_PublishOverhead::rebuiltTopic()
+{
+    QFETCH(QString, name);
+    const std::string device_name = name.toStdString();
+    int valid = 0;
+
+    // zigbee2mqtt/<name>/set from the RGBController's std::string name, then a fresh topic name
+    QBENCHMARK {
+        const QString topic = QString("zigbee2mqtt/%1/set").arg(QString::fromStdString(device_name));
+        const QMqttTopicName topic_name(topic);
+        valid += topic_name.isValid();
+    }
+    QVERIFY(valid > 0);
+}
+
+void bench_PublishOverhead::cachedTopic_data()
+{
+    addRows();
+}
+
+void bench_PublishOverhead::cachedTopic()
+{
+    QFETCH(QString, name);
+
+    // Built once when the device is created, shared by every frame after that
+    const QString topic = QString("zigbee2mqtt/%1/set").arg(name);
+    PublishOptions options;
+    options.topic_name = QMqttTopicName(topic);
+    QVERIFY(options.topic_name.isValid());
+    int valid = 0;
+
+    // What MQTTConnection::publishOne does with it
+    QBENCHMARK {
+        const PublishOptions frame = options.withDelivery(PublishOptions::Streaming);
+        const QMqttTopicName topic_name = (frame.topic_name.name() == topic) ? frame.topic_name
+                                                                              : QMqttTopicName(topic);
+        valid += topic_name.isValid();
+    }
+    QVERIFY(valid > 0);
+}
+
+void bench_PublishOverhead::deviceFrame()
+{
+    MQTTRGBDevice::LightInfo info;
+    info.name = "Living Room Ceiling Light";
+    info.unique_id = "living_room_ceiling_light";
+    info.command_topic = "homeassistant/light/living_room_ceiling_light/rgb/set";
+    info.state_topic = "homeassistant/light/living_room_ceiling_light/state";
+    info.num_leds = 1;
+    info.has_brightness = true;
+    info.has_rgb = true;
+    info.has_effects = false;
+    MosquittoLightDevice device(info);
+
+    quint64 frames = 0;
+    connect(&device, &MQTTRGBDevice::mqttPublishNeeded, this,
+            [&frames](const QString&, const QByteArray&, const PublishOptions&) { frames++; });
+
+    // A new color every frame, as an effect would send
+    unsigned char red = 0;
+    QBENCHMARK {
+        red++;
+        const unsigned char green = red * 3;
+        const unsigned char blue = red * 7;
+        device.colors[0] = ToRGBColor(red, green, blue);
+        device.DeviceUpdateLEDs();
+    }
+    QVERIFY(frames > 0);
+}
+
+QTEST_APPLESS_MAIN(bench_PublishOverhead)
+#include "bench_publishoverhead.moc"
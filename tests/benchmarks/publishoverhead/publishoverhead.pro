@@ -0,0 +1,7 @@
+include(../../harness/harness.pri)
+
+QT += testlib
+CONFIG += testcase benchmark
+TARGET = bench_publishoverhead
+
+SOURCES += bench_publishoverhead.cpp
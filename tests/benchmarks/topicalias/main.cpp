@@ -0,0 +1,99 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTest>
+#include "MQTTBrokerStandIn.h"
+#include "BenchmarkReport.h"
+#include "mqtt/MQTTHandler.h"
+
+/*---------------------------------------------------------*\
+| Topic alias benchmark                                     |
+|                                                           |
+| Bytes the broker reads for the same stream of color       |
+| frames over MQTT 3.1.1 and over MQTT 5 with topic         |
+| aliases, using the long command topics zigbee2mqtt and    |
+| Home Assistant devices tend to have.                      |
+|                                                           |
+|   bench_topicalias [--devices 8] [--frames 2000]          |
+|                    [--aliases 16]                         |
+\*---------------------------------------------------------*/
+
+namespace {
+    QJsonObject run(MQTTBrokerStandIn& broker, QMqttClient::ProtocolVersion version, quint16 aliases,
+                    const QStringList& topics, int frames)
+    {
+        MQTTHandler handler;
+        handler.setProtocol(version, aliases);
+        handler.connectToHost("127.0.0.1", broker.port());
+        if (!QTest::qWaitFor([&handler]() { return handler.isConnected(); }, 5000)) {
+            qCritical("MQTTHandler did not connect");
+            return QJsonObject();
+        }
+
+        broker.resetCounters();
+        for (int i = 0; i < frames; i++) {
+            handler.publish(topics[i % topics.size()], QByteArray("#ff8000") + QByteArray::number(i % 100));
+        }
+        QTest::qWaitFor([&broker, frames]() { return broker.publishesReceived() >= static_cast<quint64>(frames); }, 10000);
+
+        const MQTTHandler::PublishStats stats = handler.publishStats();
+        QJsonObject result;
+        result["protocol"] = version == QMqttClient::MQTT_5_0 ? "5.0" : "3.1.1";
+        result["alias_limit"] = version == QMqttClient::MQTT_5_0 ? aliases : 0;
+        result["devices"] = topics.size();
+        result["frames"] = frames;
+        result["received"] = static_cast<double>(broker.publishesReceived());
+        result["wire_bytes"] = static_cast<double>(broker.bytesReceived());
+        result["wire_bytes_per_frame"] = broker.publishesReceived() > 0
+            ? static_cast<double>(broker.bytesReceived()) / broker.publishesReceived() : 0.0;
+        result["aliased"] = static_cast<double>(stats.aliased);
+        result["alias_bytes_saved"] = static_cast<double>(stats.alias_bytes_saved);
+        return result;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    const QCommandLineOption devices_option("devices", "Command topics published round-robin.", "n", "8");
+    const QCommandLineOption frames_option("frames", "Frames published per protocol.", "n", "2000");
+    const QCommandLineOption aliases_option("aliases", "Topic Alias Maximum for MQTT 5.", "n", "16");
+    parser.addOptions({devices_option, frames_option, aliases_option});
+    parser.process(app);
+
+    const int devices = qMax(1, parser.value(devices_option).toInt());
+    const int frames = qMax(1, parser.value(frames_option).toInt());
+    const quint16 aliases = static_cast<quint16>(qBound(0, parser.value(aliases_option).toInt(), 65535));
+
+    QStringList topics;
+    for (int i = 0; i < devices; i++) {
+        topics << (i % 2 == 0 ? QString("zigbee2mqtt/Living Room Ceiling Light %1/set").arg(i)
+                              : QString("homeassistant/light/openrgb_bridge/desk_strip_%1/rgb/set").arg(i));
+    }
+
+    MQTTBrokerStandIn broker;
+    broker.setTopicAliasMaximum(aliases);
+    if (!broker.listen()) {
+        qCritical("Broker stand-in could not listen");
+        return 1;
+    }
+
+    const QJsonObject plain = run(broker, QMqttClient::MQTT_3_1_1, 0, topics, frames);
+    const QJsonObject aliased = run(broker, QMqttClient::MQTT_5_0, aliases, topics, frames);
+    if (plain.isEmpty() || aliased.isEmpty())
+        return 1;
+
+    BenchmarkReport::write("topic_alias", plain);
+    BenchmarkReport::write("topic_alias", aliased);
+
+    QJsonObject saving;
+    const double plain_bytes = plain["wire_bytes"].toDouble();
+    saving["devices"] = devices;
+    saving["frames"] = frames;
+    saving["bytes_saved"] = plain_bytes - aliased["wire_bytes"].toDouble();
+    saving["saved_pct"] = plain_bytes > 0 ? 100.0 * (plain_bytes - aliased["wire_bytes"].toDouble()) / plain_bytes : 0.0;
+    BenchmarkReport::write("topic_alias_saving", saving);
+    return 0;
+}
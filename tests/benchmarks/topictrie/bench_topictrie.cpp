@@ -0,0 +1,132 @@
+#include <QtTest>
+#include <QMap>
+#include "mqtt/TopicTrie.h"
+
+/*---------------------------------------------------------*\
+| bench_TopicTrie                                           |
+|                                                           |
+| Routing cost with 10k registered device state topics,     |
+| next to the string-test chain and QMap lookup the trie    |
+| replaced. Run with -csv or -o file,xml for machine output.|
+\*---------------------------------------------------------*/
+
+class bench_TopicTrie : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void insertDeviceRoutes();
+    void dispatchByTopic_data();
+    void dispatchByTopic();
+    void dispatchById_data();
+    void dispatchById();
+    void stringChainBaseline_data();
+    void stringChainBaseline();
+
+private:
+    static const int DEVICE_COUNT = 10000;
+
+    TopicTrie trie;
+    QMap<QString, int> device_map;      // The pre-trie per-device lookup
+    QStringList device_topics;
+    quint64 handled = 0;
+
+    void addRows();
+};
+
+void bench_TopicTrie::initTestCase()
+{
+    for (int i = 0; i < DEVICE_COUNT; i++) {
+        device_topics << QString("zigbee2mqtt/Living Room Light %1").arg(i);
+    }
+
+    auto handler = [this](const QString&, const QByteArray&) { handled++; };
+    trie.insert("homeassistant/light/+/config", handler);
+    trie.insert("homeassistant/light/+/+/config", handler);
+    trie.insert("zigbee2mqtt/bridge/state", handler);
+    trie.insert("zigbee2mqtt/bridge/devices", handler);
+    for (int i = 0; i < DEVICE_COUNT; i++) {
+        trie.insert(device_topics[i], handler);
+        device_map.insert(device_topics[i], i);
+    }
+}
+
+void bench_TopicTrie::insertDeviceRoutes()
+{
+    QBENCHMARK {
+        TopicTrie fresh;
+        for (const QString& topic : device_topics) {
+            fresh.insert(topic, [](const QString&, const QByteArray&) {});
+        }
+    }
+}
+
+void bench_TopicTrie::addRows()
+{
+    // Each topic gets its own id, as TopicTable would hand out
+    QTest::addColumn<QString>("topic");
+    QTest::addColumn<uint>("id");
+    QTest::newRow("device state") << device_topics[DEVICE_COUNT / 2] << 1u;
+    QTest::newRow("ha discovery") << QString("homeassistant/light/node/lamp_1234/config") << 2u;
+    QTest::newRow("bridge") << QString("zigbee2mqtt/bridge/state") << 3u;
+    QTest::newRow("unrouted") << QString("tasmota/discovery/ABCDEF/config") << 4u;
+}
+
+void bench_TopicTrie::dispatchByTopic_data()
+{
+    addRows();
+}
+
+void bench_TopicTrie::dispatchByTopic()
+{
+    QFETCH(QString, topic);
+    const QByteArray payload("{\"state\":\"ON\"}");
+
+    QBENCHMARK {
+        trie.dispatch(topic, payload);
+    }
+}
+
+void bench_TopicTrie::dispatchById_data()
+{
+    addRows();
+}
+
+void bench_TopicTrie::dispatchById()
+{
+    QFETCH(QString, topic);
+    QFETCH(uint, id);
+    const QByteArray payload("{\"state\":\"ON\"}");
+
+    QBENCHMARK {
+        trie.dispatch(static_cast<TopicId>(id), topic, payload);
+    }
+}
+
+void bench_TopicTrie::stringChainBaseline_data()
+{
+    addRows();
+}
+
+void bench_TopicTrie::stringChainBaseline()
+{
+    QFETCH(QString, topic);
+
+    // What DeviceManager and the protocol managers did per message before the trie
+    QBENCHMARK {
+        if (topic.startsWith("homeassistant/")) {
+            if (topic.startsWith("homeassistant/light/") && topic.endsWith("/config"))
+                handled++;
+        } else if (topic.startsWith("zigbee2mqtt/")) {
+            if (topic == "zigbee2mqtt/bridge/state" || topic == "zigbee2mqtt/bridge/devices")
+                handled++;
+            else if (device_map.contains(topic))
+                handled++;
+        }
+    }
+}
+
+QTEST_APPLESS_MAIN(bench_TopicTrie)
+#include "bench_topictrie.moc"
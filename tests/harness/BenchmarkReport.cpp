@@ -0,0 +1,55 @@
+#include "BenchmarkReport.h"
+#include <QFile>
+#include <QJsonDocument>
+#include <QTextStream>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+QJsonObject BenchmarkReport::latency(const LatencyHistogram::Snapshot& snapshot)
+{
+    QJsonObject result;
+    result["count"] = static_cast<double>(snapshot.count);
+    result["mean_us"] = snapshot.meanNs() / 1000.0;
+    result["p50_us"] = snapshot.percentileNs(0.5) / 1000.0;
+    result["p99_us"] = snapshot.percentileNs(0.99) / 1000.0;
+    result["p999_us"] = snapshot.percentileNs(0.999) / 1000.0;
+    result["max_us"] = snapshot.max_ns / 1000.0;
+    return result;
+}
+
+void BenchmarkReport::write(const QString& name, QJsonObject result)
+{
+    result["benchmark"] = name;
+    const QByteArray line = QJsonDocument(result).toJson(QJsonDocument::Compact) + '\n';
+
+    QTextStream(stdout) << line;
+
+    const QString path = qEnvironmentVariable("OPENRGB2MQTT_BENCH_OUT");
+    if (!path.isEmpty()) {
+        QFile file(path);
+        if (file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            file.write(line);
+        }
+    }
+}
+
+qint64 BenchmarkReport::cpuTimeNs()
+{
+#ifdef Q_OS_WIN
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+        return 0;
+    const quint64 kernel_100ns = (static_cast<quint64>(kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime;
+    const quint64 user_100ns = (static_cast<quint64>(user.dwHighDateTime) << 32) | user.dwLowDateTime;
+    return static_cast<qint64>((kernel_100ns + user_100ns) * 100);
+#else
+    timespec now;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now) != 0)
+        return 0;
+    return static_cast<qint64>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+#endif
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <QString>
+#include <QJsonObject>
+#include "utils/LatencyHistogram.h"
+
+/*---------------------------------------------------------*\
+| BenchmarkReport                                           |
+|                                                           |
+| Machine-readable benchmark output: one compact JSON       |
+| object per result line on stdout, so runs can be diffed   |
+| and tracked for regressions. With OPENRGB2MQTT_BENCH_OUT  |
+| set, the same lines are appended to that file as well.    |
+\*---------------------------------------------------------*/
+
+namespace BenchmarkReport
+{
+    // { count, mean_us, p50_us, p99_us, p999_us, max_us }, the fields Latency::report() uses
+    QJsonObject latency(const LatencyHistogram::Snapshot& snapshot);
+
+    // Writes result with "benchmark": name added
+    void write(const QString& name, QJsonObject result);
+
+    // Process CPU time over all threads, for idle and per-message cost
+    qint64 cpuTimeNs();
+}
@@ -0,0 +1,718 @@
+#include "MQTTBrokerStandIn.h"
+#include <QHostAddress>
+#include <algorithm>
+#include <chrono>
+
+namespace {
+    // MQTT control packet types, the high nibble of the fixed header
+    enum PacketType {
+        CONNECT = 1, CONNACK, PUBLISH, PUBACK, PUBREC, PUBREL, PUBCOMP,
+        SUBSCRIBE, SUBACK, UNSUBSCRIBE, UNSUBACK, PINGREQ, PINGRESP, DISCONNECT
+    };
+
+    // MQTT 5 property identifiers the broker reads or writes
+    const quint8 PROP_ASSIGNED_CLIENT_ID = 0x12;
+    const quint8 PROP_TOPIC_ALIAS_MAXIMUM = 0x22;
+    const quint8 PROP_TOPIC_ALIAS = 0x23;
+
+    // Kernel receive buffer for throttled clients, so unread data backs up into the sender
+    const int THROTTLED_SOCKET_BUFFER = 16 * 1024;
+    const int THROTTLE_TICK_MS = 10;
+
+    struct PacketReader {
+        explicit PacketReader(const QByteArray& packet_data) : data(packet_data) {}
+
+        const QByteArray& data;
+        int pos = 0;
+        bool ok = true;
+
+        bool need(qint64 bytes) {
+            if (pos + bytes > data.size())
+                ok = false;
+            return ok;
+        }
+        quint8 u8() {
+            if (!need(1))
+                return 0;
+            return static_cast<quint8>(data[pos++]);
+        }
+        quint16 u16() {
+            const quint16 high = u8();
+            return static_cast<quint16>((high << 8) | u8());
+        }
+        quint32 u32() {
+            const quint32 high = u16();
+            return (high << 16) | u16();
+        }
+        quint32 varint() {
+            quint32 value = 0;
+            for (int shift = 0; shift < 28 && ok; shift += 7) {
+                const quint8 byte = u8();
+                value |= static_cast<quint32>(byte & 0x7F) << shift;
+                if (!(byte & 0x80))
+                    return value;
+            }
+            ok = false;
+            return 0;
+        }
+        QByteArray binary() {
+            const quint16 length = u16();
+            if (!need(length))
+                return QByteArray();
+            QByteArray value = data.mid(pos, length);
+            pos += length;
+            return value;
+        }
+        QString string() { return QString::fromUtf8(binary()); }
+
+        // Walks an MQTT 5 property block, keeping the numeric ones
+        void properties(QHash<quint8, quint32>* numeric) {
+            const quint32 length = varint();
+            if (!need(length))
+                return;
+            const int end = pos + static_cast<int>(length);
+            while (ok && pos < end) {
+                const quint8 id = u8();
+                quint32 value = 0;
+                switch (id) {
+                case 0x01: case 0x17: case 0x19: case 0x24: case 0x25: case 0x28: case 0x29: case 0x2A:
+                    value = u8();
+                    break;
+                case 0x13: case 0x21: case 0x22: case 0x23:
+                    value = u16();
+                    break;
+                case 0x02: case 0x11: case 0x18: case 0x27:
+                    value = u32();
+                    break;
+                case 0x0B:
+                    value = varint();
+                    break;
+                case 0x03: case 0x08: case 0x09: case 0x12: case 0x15: case 0x16: case 0x1A: case 0x1C: case 0x1F:
+                    binary();
+                    break;
+                case 0x26:
+                    binary();
+                    binary();
+                    break;
+                default:
+                    ok = false;
+                    break;
+                }
+                if (numeric)
+                    numeric->insert(id, value);
+            }
+            if (pos != end)
+                ok = false;
+        }
+    };
+
+    void appendU16(QByteArray& out, quint16 value)
+    {
+        out.append(static_cast<char>(value >> 8));
+        out.append(static_cast<char>(value & 0xFF));
+    }
+
+    void appendBinary(QByteArray& out, const QByteArray& value)
+    {
+        appendU16(out, static_cast<quint16>(value.size()));
+        out.append(value);
+    }
+
+    void appendVarint(QByteArray& out, quint32 value)
+    {
+        do {
+            quint8 byte = value & 0x7F;
+            value >>= 7;
+            if (value)
+                byte |= 0x80;
+            out.append(static_cast<char>(byte));
+        } while (value);
+    }
+}
+
+MQTTBrokerStandIn::MQTTBrokerStandIn(QObject* parent)
+    : QObject(parent)
+    , server(new QTcpServer(this))
+    , throttleTimer(new QTimer(this))
+    , serverPort(0)
+    , nextClientId(0)
+    , latencyMs(0)
+    , bandwidthBytesPerSec(0)
+    , lastThrottleNs(0)
+    , topicAliasMaximum(0)
+    , receivedBytes(0)
+    , receivedPublishes(0)
+    , receivedSubscribes(0)
+{
+    connect(server, &QTcpServer::newConnection, this, &MQTTBrokerStandIn::acceptClients);
+
+    throttleTimer->setInterval(THROTTLE_TICK_MS);
+    throttleTimer->setTimerType(Qt::PreciseTimer);
+    connect(throttleTimer, &QTimer::timeout, this, &MQTTBrokerStandIn::readThrottled);
+}
+
+MQTTBrokerStandIn::~MQTTBrokerStandIn()
+{
+    close();
+}
+
+bool MQTTBrokerStandIn::listen(quint16 port)
+{
+    if (port == 0)
+        port = serverPort;
+    if (!server->listen(QHostAddress::LocalHost, port))
+        return false;
+    serverPort = server->serverPort();
+    return true;
+}
+
+void MQTTBrokerStandIn::close()
+{
+    server->close();
+
+    // Like a broker crash: no DISCONNECT, and no wills since nobody is left to get them
+    const QList<Client*> dropped = clients;
+    for (Client* client : dropped) {
+        dropClient(client, true);
+    }
+}
+
+void MQTTBrokerStandIn::setLatency(int msec)
+{
+    latencyMs = qMax(0, msec);
+}
+
+void MQTTBrokerStandIn::setBandwidthLimit(qint64 bytes_per_sec)
+{
+    bandwidthBytesPerSec = qMax<qint64>(0, bytes_per_sec);
+    lastThrottleNs = nowNs();
+
+    for (Client* client : clients) {
+        applyBandwidth(client);
+    }
+
+    if (bandwidthBytesPerSec > 0) {
+        throttleTimer->start();
+    } else {
+        throttleTimer->stop();
+        // Whatever piled up while throttled is read now
+        for (Client* client : clients) {
+            readFrom(client, -1);
+        }
+    }
+}
+
+void MQTTBrokerStandIn::setTopicAliasMaximum(quint16 maximum)
+{
+    topicAliasMaximum = maximum;
+}
+
+void MQTTBrokerStandIn::publish(const QString& topic, const QByteArray& payload, bool retain)
+{
+    if (retain) {
+        if (payload.isEmpty())
+            retained.remove(topic);
+        else
+            retained.insert(topic, payload);
+    }
+    route(topic, payload);
+}
+
+int MQTTBrokerStandIn::clientCount() const
+{
+    int count = 0;
+    for (const Client* client : clients) {
+        if (client->protocolLevel != 0)
+            count++;
+    }
+    return count;
+}
+
+QStringList MQTTBrokerStandIn::subscriptions() const
+{
+    QStringList filters;
+    for (const Client* client : clients) {
+        filters.append(client->subscriptions.keys());
+    }
+    filters.sort();
+    filters.removeDuplicates();
+    return filters;
+}
+
+QByteArray MQTTBrokerStandIn::retainedMessage(const QString& topic) const
+{
+    return retained.value(topic);
+}
+
+void MQTTBrokerStandIn::resetCounters()
+{
+    receivedBytes = 0;
+    receivedPublishes = 0;
+    receivedSubscribes = 0;
+}
+
+qint64 MQTTBrokerStandIn::nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool MQTTBrokerStandIn::topicMatches(const QString& filter, const QString& topic)
+{
+    const QStringList filter_levels = filter.split('/');
+    const QStringList topic_levels = topic.split('/');
+
+    // Wildcards at the first level do not reach $SYS-style topics
+    if (topic.startsWith('$') && (filter_levels[0] == "+" || filter_levels[0] == "#"))
+        return false;
+
+    for (int i = 0; i < filter_levels.size(); i++) {
+        if (filter_levels[i] == "#")
+            return true;    // Also matches the parent level itself
+        if (i >= topic_levels.size())
+            return false;
+        if (filter_levels[i] != "+" && filter_levels[i] != topic_levels[i])
+            return false;
+    }
+    return filter_levels.size() == topic_levels.size();
+}
+
+void MQTTBrokerStandIn::acceptClients()
+{
+    while (server->hasPendingConnections()) {
+        QTcpSocket* socket = server->nextPendingConnection();
+        Client* client = new Client;
+        client->socket = socket;
+        clients.append(client);
+
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        applyBandwidth(client);
+
+        connect(socket, &QTcpSocket::readyRead, this, [this, client]() {
+            // Throttled clients are read by readThrottled instead
+            if (bandwidthBytesPerSec == 0)
+                readFrom(client, -1);
+        });
+        connect(socket, &QTcpSocket::disconnected, this, [this, client]() {
+            dropClient(client, false);
+        });
+        connect(socket, &QObject::destroyed, [client]() {
+            delete client;
+        });
+    }
+}
+
+void MQTTBrokerStandIn::applyBandwidth(Client* client)
+{
+    if (bandwidthBytesPerSec > 0) {
+        client->socket->setReadBufferSize(qMax<qint64>(bandwidthBytesPerSec * THROTTLE_TICK_MS / 1000, 1024));
+        client->socket->setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption, THROTTLED_SOCKET_BUFFER);
+    } else {
+        client->socket->setReadBufferSize(0);
+    }
+}
+
+void MQTTBrokerStandIn::readThrottled()
+{
+    // Budget from the time actually elapsed, so a late tick does not lower the rate
+    const qint64 now = nowNs();
+    const qint64 budget = bandwidthBytesPerSec * (now - lastThrottleNs) / 1000000000LL;
+    if (budget <= 0)
+        return;
+    lastThrottleNs = now;
+
+    const QList<Client*> throttled = clients;
+    for (Client* client : throttled) {
+        readFrom(client, budget);
+    }
+}
+
+void MQTTBrokerStandIn::readFrom(Client* client, qint64 max_bytes)
+{
+    if (client->closing)
+        return;
+
+    const QByteArray data = max_bytes < 0 ? client->socket->readAll() : client->socket->read(max_bytes);
+    if (data.isEmpty())
+        return;
+
+    client->inbox.append(data);
+    splitPackets(client);
+}
+
+void MQTTBrokerStandIn::splitPackets(Client* client)
+{
+    while (!client->closing && client->inbox.size() >= 2) {
+        // Fixed header: type and flags, then the remaining length in up to four bytes
+        quint32 length = 0;
+        int header_bytes = 1;
+        bool complete = false;
+        for (int shift = 0; shift < 28; shift += 7) {
+            if (header_bytes >= client->inbox.size())
+                return;
+            const quint8 byte = static_cast<quint8>(client->inbox[header_bytes++]);
+            length |= static_cast<quint32>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                complete = true;
+                break;
+            }
+        }
+        if (!complete) {
+            dropClient(client, false);
+            return;
+        }
+
+        const int wire_bytes = header_bytes + static_cast<int>(length);
+        if (client->inbox.size() < wire_bytes)
+            return;
+
+        Packet packet;
+        packet.header = static_cast<quint8>(client->inbox[0]);
+        packet.body = client->inbox.mid(header_bytes, static_cast<int>(length));
+        packet.received_ns = nowNs();
+        packet.due_ns = packet.received_ns + static_cast<qint64>(latencyMs) * 1000000;
+        packet.wire_bytes = wire_bytes;
+        client->inbox.remove(0, wire_bytes);
+        receivedBytes += wire_bytes;
+
+        // Packets keep their order: once one is delayed, the ones behind it wait too
+        if (latencyMs > 0 || !client->delayed.empty()) {
+            client->delayed.push_back(packet);
+            QTimer::singleShot(latencyMs, Qt::PreciseTimer, client->socket, [this, client]() {
+                processDue(client);
+            });
+        } else {
+            handlePacket(client, packet);
+        }
+    }
+}
+
+void MQTTBrokerStandIn::processDue(Client* client)
+{
+    const qint64 now = nowNs();
+    while (!client->closing && !client->delayed.empty() && client->delayed.front().due_ns <= now) {
+        const Packet packet = client->delayed.front();
+        client->delayed.pop_front();
+        handlePacket(client, packet);
+    }
+
+    // A timer fired early - come back for the rest
+    if (!client->closing && !client->delayed.empty()) {
+        const int wait_ms = static_cast<int>((client->delayed.front().due_ns - now + 999999) / 1000000);
+        QTimer::singleShot(wait_ms, Qt::PreciseTimer, client->socket, [this, client]() {
+            processDue(client);
+        });
+    }
+}
+
+void MQTTBrokerStandIn::handlePacket(Client* client, const Packet& packet)
+{
+    const int type = packet.header >> 4;
+
+    if (client->protocolLevel == 0 && type != CONNECT) {
+        dropClient(client, false);
+        return;
+    }
+
+    switch (type) {
+    case CONNECT:
+        handleConnect(client, packet.body);
+        break;
+    case PUBLISH:
+        handlePublish(client, packet);
+        break;
+    case PUBREL: {
+        // Second half of a QoS 2 exchange
+        QByteArray ack = packet.body.left(2);
+        if (client->protocolLevel == 5)
+            ack.append(QByteArray(2, '\0'));
+        send(client, PUBCOMP << 4, ack);
+        break;
+    }
+    case PUBACK:
+    case PUBREC:
+    case PUBCOMP:
+        // Deliveries go out at QoS 0, nothing to acknowledge
+        break;
+    case SUBSCRIBE:
+        handleSubscribe(client, packet.body);
+        break;
+    case UNSUBSCRIBE:
+        handleUnsubscribe(client, packet.body);
+        break;
+    case PINGREQ:
+        send(client, PINGRESP << 4, QByteArray());
+        break;
+    case DISCONNECT:
+        dropClient(client, true);
+        break;
+    default:
+        dropClient(client, false);
+        break;
+    }
+}
+
+void MQTTBrokerStandIn::handleConnect(Client* client, const QByteArray& body)
+{
+    PacketReader reader(body);
+    const QString protocol = reader.string();
+    const quint8 level = reader.u8();
+    const quint8 flags = reader.u8();
+    reader.u16();   // Keep alive - the stand-in never times clients out
+
+    if (!reader.ok || protocol != "MQTT" || (level != 4 && level != 5)) {
+        // 3.1.1 "unacceptable protocol version", which every client version understands
+        send(client, CONNACK << 4, QByteArray("\x00\x01", 2));
+        dropClient(client, true);
+        return;
+    }
+
+    if (level == 5)
+        reader.properties(nullptr);
+    QString id = reader.string();
+    if (flags & 0x04) {
+        if (level == 5)
+            reader.properties(nullptr);
+        client->willTopic = reader.string();
+        client->willPayload = reader.binary();
+        client->willRetain = flags & 0x20;
+    }
+    if (flags & 0x80)
+        reader.string();    // Username
+    if (flags & 0x40)
+        reader.binary();    // Password
+    if (!reader.ok) {
+        dropClient(client, false);
+        return;
+    }
+
+    const bool assigned = id.isEmpty();
+    if (assigned)
+        id = QString("standin-%1").arg(++nextClientId);
+
+    // A second connection with the same client ID takes over the session
+    const QList<Client*> existing = clients;
+    for (Client* other : existing) {
+        if (other != client && other->protocolLevel != 0 && other->id == id) {
+            dropClient(other, true);
+        }
+    }
+
+    client->id = id;
+    client->protocolLevel = level;
+    client->persistent = !(flags & 0x02);
+
+    bool session_present = false;
+    if (client->persistent && sessions.contains(id)) {
+        client->subscriptions = sessions.value(id);
+        session_present = true;
+    } else if (!client->persistent) {
+        sessions.remove(id);
+    }
+
+    QByteArray ack;
+    ack.append(static_cast<char>(session_present ? 0x01 : 0x00));
+    ack.append('\0');
+    if (level == 5) {
+        QByteArray properties;
+        if (topicAliasMaximum > 0) {
+            properties.append(static_cast<char>(PROP_TOPIC_ALIAS_MAXIMUM));
+            appendU16(properties, topicAliasMaximum);
+        }
+        if (assigned) {
+            properties.append(static_cast<char>(PROP_ASSIGNED_CLIENT_ID));
+            appendBinary(properties, id.toUtf8());
+        }
+        appendVarint(ack, static_cast<quint32>(properties.size()));
+        ack.append(properties);
+    }
+    send(client, CONNACK << 4, ack);
+
+    emit clientConnected(id, level);
+}
+
+void MQTTBrokerStandIn::handlePublish(Client* client, const Packet& packet)
+{
+    const quint8 qos = (packet.header >> 1) & 0x03;
+    const bool retain = packet.header & 0x01;
+
+    PacketReader reader(packet.body);
+    QString topic = reader.string();
+    const quint16 packet_id = qos > 0 ? reader.u16() : 0;
+    quint32 alias = 0;
+    if (client->protocolLevel == 5) {
+        QHash<quint8, quint32> properties;
+        reader.properties(&properties);
+        alias = properties.value(PROP_TOPIC_ALIAS, 0);
+    }
+    if (!reader.ok || qos > 2) {
+        dropClient(client, false);
+        return;
+    }
+    const QByteArray payload = packet.body.mid(reader.pos);
+
+    // MQTT 5 topic alias: a topic sets the alias, an empty topic uses it
+    if (alias != 0) {
+        if (alias > topicAliasMaximum) {
+            dropClient(client, false);
+            return;
+        }
+        if (topic.isEmpty())
+            topic = client->aliases.value(static_cast<quint16>(alias));
+        else
+            client->aliases.insert(static_cast<quint16>(alias), topic);
+    }
+    if (topic.isEmpty()) {
+        dropClient(client, false);
+        return;
+    }
+
+    receivedPublishes++;
+
+    if (qos > 0) {
+        QByteArray ack;
+        appendU16(ack, packet_id);
+        if (client->protocolLevel == 5)
+            ack.append(QByteArray(2, '\0'));    // Success, no properties
+        send(client, (qos == 1 ? PUBACK : PUBREC) << 4, ack);
+    }
+
+    if (retain) {
+        if (payload.isEmpty())
+            retained.remove(topic);
+        else
+            retained.insert(topic, payload);
+    }
+
+    emit published(topic, payload, packet.received_ns, packet.wire_bytes);
+    route(topic, payload);
+}
+
+void MQTTBrokerStandIn::handleSubscribe(Client* client, const QByteArray& body)
+{
+    PacketReader reader(body);
+    const quint16 packet_id = reader.u16();
+    if (client->protocolLevel == 5)
+        reader.properties(nullptr);
+
+    QList<QPair<QString, quint8>> requested;
+    while (reader.ok && reader.pos < body.size()) {
+        const QString filter = reader.string();
+        const quint8 options = reader.u8();
+        requested.append(qMakePair(filter, static_cast<quint8>(options & 0x03)));
+    }
+    if (!reader.ok || requested.isEmpty()) {
+        dropClient(client, false);
+        return;
+    }
+
+    receivedSubscribes++;
+
+    QByteArray ack;
+    appendU16(ack, packet_id);
+    if (client->protocolLevel == 5)
+        ack.append('\0');
+    for (const auto& entry : requested) {
+        client->subscriptions.insert(entry.first, entry.second);
+        ack.append(static_cast<char>(entry.second));
+    }
+    send(client, SUBACK << 4, ack);
+
+    for (const auto& entry : requested) {
+        emit subscribed(entry.first);
+
+        for (auto it = retained.constBegin(); it != retained.constEnd(); ++it) {
+            if (topicMatches(entry.first, it.key()))
+                deliver(client, it.key(), it.value(), true);
+        }
+    }
+}
+
+void MQTTBrokerStandIn::handleUnsubscribe(Client* client, const QByteArray& body)
+{
+    PacketReader reader(body);
+    const quint16 packet_id = reader.u16();
+    if (client->protocolLevel == 5)
+        reader.properties(nullptr);
+
+    QStringList filters;
+    while (reader.ok && reader.pos < body.size()) {
+        filters.append(reader.string());
+    }
+    if (!reader.ok || filters.isEmpty()) {
+        dropClient(client, false);
+        return;
+    }
+
+    QByteArray ack;
+    appendU16(ack, packet_id);
+    if (client->protocolLevel == 5)
+        ack.append('\0');
+    for (const QString& filter : filters) {
+        client->subscriptions.remove(filter);
+        if (client->protocolLevel == 5)
+            ack.append('\0');   // Success per filter
+    }
+    send(client, UNSUBACK << 4, ack);
+}
+
+void MQTTBrokerStandIn::route(const QString& topic, const QByteArray& payload)
+{
+    for (Client* client : clients) {
+        if (client->protocolLevel == 0 || client->closing)
+            continue;
+
+        // Overlapping filters still deliver the message once
+        for (auto it = client->subscriptions.constBegin(); it != client->subscriptions.constEnd(); ++it) {
+            if (topicMatches(it.key(), topic)) {
+                deliver(client, topic, payload, false);
+                break;
+            }
+        }
+    }
+}
+
+void MQTTBrokerStandIn::deliver(Client* client, const QString& topic, const QByteArray& payload, bool retain)
+{
+    QByteArray body;
+    appendBinary(body, topic.toUtf8());
+    if (client->protocolLevel == 5)
+        body.append('\0');
+    body.append(payload);
+    send(client, static_cast<quint8>((PUBLISH << 4) | (retain ? 0x01 : 0x00)), body);
+}
+
+void MQTTBrokerStandIn::send(Client* client, quint8 header, const QByteArray& body)
+{
+    if (client->closing)
+        return;
+
+    QByteArray packet;
+    packet.reserve(body.size() + 5);
+    packet.append(static_cast<char>(header));
+    appendVarint(packet, static_cast<quint32>(body.size()));
+    packet.append(body);
+    client->socket->write(packet);
+}
+
+void MQTTBrokerStandIn::dropClient(Client* client, bool graceful)
+{
+    if (client->closing)
+        return;
+    client->closing = true;
+    clients.removeOne(client);
+
+    if (client->protocolLevel != 0) {
+        if (client->persistent)
+            sessions.insert(client->id, client->subscriptions);
+
+        if (!graceful && !client->willTopic.isEmpty())
+            publish(client->willTopic, client->willPayload, client->willRetain);
+
+        emit clientDisconnected(client->id);
+    }
+
+    // The Client itself goes with its socket
+    client->socket->abort();
+    client->socket->deleteLater();
+}
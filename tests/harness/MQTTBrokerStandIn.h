@@ -0,0 +1,138 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QMap>
+#include <QList>
+#include <QStringList>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <deque>
+
+/*---------------------------------------------------------*\
+| MQTTBrokerStandIn                                         |
+|                                                           |
+| Minimal in-process MQTT 3.1.1 / 5 broker bound to         |
+| localhost, for tests and benchmarks. It speaks enough of  |
+| the protocol for QMqttClient: CONNECT, PUBLISH (QoS 0-2), |
+| SUBSCRIBE, UNSUBSCRIBE, PINGREQ, DISCONNECT, retained     |
+| messages, + and # wildcards, wills, MQTT 5 topic aliases  |
+| and persistent sessions. Messages are forwarded at QoS 0. |
+|                                                           |
+| Network conditions are injected per client connection:    |
+| setLatency delays every packet the broker receives        |
+| before it is acted on, setBandwidthLimit caps how fast    |
+| the broker reads from each socket. close() drops every    |
+| client, so a test can make the broker flap.               |
+|                                                           |
+| Lives on the thread that created it; run that thread's    |
+| event loop (QTest::qWait, QSignalSpy::wait) to serve.     |
+\*---------------------------------------------------------*/
+
+class MQTTBrokerStandIn : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MQTTBrokerStandIn(QObject* parent = nullptr);
+    ~MQTTBrokerStandIn();
+
+    // Listens on 127.0.0.1; port 0 picks a free one, or reuses the last port after close()
+    bool listen(quint16 port = 0);
+    void close();
+    bool isListening() const { return server->isListening(); }
+    quint16 port() const { return serverPort; }
+
+    // Injected network conditions, applied to clients connected before or after the call
+    void setLatency(int msec);
+    void setBandwidthLimit(qint64 bytes_per_sec);  // 0 reads as fast as data arrives
+
+    // Advertised in the MQTT 5 CONNACK, 0 leaves topic aliases off
+    void setTopicAliasMaximum(quint16 maximum);
+
+    // Publishes from the broker itself, e.g. retained discovery configs
+    void publish(const QString& topic, const QByteArray& payload, bool retain = false);
+
+    // Inspection
+    int clientCount() const;
+    QStringList subscriptions() const;          // Every filter held, over all clients
+    QByteArray retainedMessage(const QString& topic) const;
+    quint64 bytesReceived() const { return receivedBytes; }
+    quint64 publishesReceived() const { return receivedPublishes; }
+    quint64 subscribePackets() const { return receivedSubscribes; }
+    void resetCounters();
+
+    static bool topicMatches(const QString& filter, const QString& topic);
+
+    // Steady clock in nanoseconds, the time base of received_ns
+    static qint64 nowNs();
+
+signals:
+    void clientConnected(const QString& client_id, int protocol_level);
+    void clientDisconnected(const QString& client_id);
+
+    // A client PUBLISH, once its injected latency has passed. received_ns is the
+    // nowNs() at which its last byte was read off the socket.
+    void published(const QString& topic, const QByteArray& payload, qint64 received_ns, int wire_bytes);
+    void subscribed(const QString& filter);
+
+private slots:
+    void acceptClients();
+    void readThrottled();
+
+private:
+    struct Packet {
+        quint8 header;
+        QByteArray body;
+        qint64 received_ns;
+        qint64 due_ns;          // When the injected latency has passed
+        int wire_bytes;
+    };
+
+    struct Client {
+        QTcpSocket* socket = nullptr;
+        QString id;
+        int protocolLevel = 0;  // 4 = 3.1.1, 5 = 5.0, 0 before CONNECT
+        bool persistent = false;
+        bool closing = false;
+        QByteArray inbox;       // Read but not yet split into packets
+        std::deque<Packet> delayed;
+        QMap<QString, quint8> subscriptions;
+        QHash<quint16, QString> aliases;
+        QString willTopic;
+        QByteArray willPayload;
+        bool willRetain = false;
+    };
+
+    QTcpServer* server;
+    QTimer* throttleTimer;
+    quint16 serverPort;
+    int nextClientId;
+    QList<Client*> clients;
+    QMap<QString, QByteArray> retained;
+    QHash<QString, QMap<QString, quint8>> sessions;    // Persistent client id -> subscriptions
+    int latencyMs;
+    qint64 bandwidthBytesPerSec;
+    qint64 lastThrottleNs;
+    quint16 topicAliasMaximum;
+    quint64 receivedBytes;
+    quint64 receivedPublishes;
+    quint64 receivedSubscribes;
+
+    void applyBandwidth(Client* client);
+    void readFrom(Client* client, qint64 max_bytes);
+    void splitPackets(Client* client);
+    void processDue(Client* client);
+    void handlePacket(Client* client, const Packet& packet);
+    void handleConnect(Client* client, const QByteArray& body);
+    void handlePublish(Client* client, const Packet& packet);
+    void handleSubscribe(Client* client, const QByteArray& body);
+    void handleUnsubscribe(Client* client, const QByteArray& body);
+    void route(const QString& topic, const QByteArray& payload);
+    void deliver(Client* client, const QString& topic, const QByteArray& payload, bool retain);
+    void send(Client* client, quint8 header, const QByteArray& body);
+    void dropClient(Client* client, bool graceful);
+};
@@ -0,0 +1,35 @@
+# Build settings shared by the harness library and every test and benchmark
+OPENRGB2MQTT_ROOT = $$clean_path($$PWD/../..)
+
+include($$OPENRGB2MQTT_ROOT/mqtt_qt_setup/mkspecs/modules/qt_lib_mqtt.pri)
+
+QT += core gui network widgets
+CONFIG += silent c++17
+
+DEFINES += GIT_COMMIT_ID=\\\"test-build\\\"
+DEFINES += GIT_COMMIT_DATE=\\\"test-date\\\"
+DEFINES += VERSION_STRING=\\\"test\\\"
+DEFINES += OPENRGB2MQTT_TRACE_LEVEL=2
+
+win32 {
+    DEFINES += WIN32 _CRT_SECURE_NO_WARNINGS USE_HID_USAGE
+}
+unix:!macx {
+    QMAKE_CXXFLAGS += -std=c++17 -Wno-psabi
+}
+
+INCLUDEPATH += \
+    $$PWD \
+    $$OPENRGB2MQTT_ROOT \
+    $$OPENRGB2MQTT_ROOT/mqtt_qt_setup/include \
+    $$OPENRGB2MQTT_ROOT/src \
+    $$OPENRGB2MQTT_ROOT/src/devices/base \
+    $$OPENRGB2MQTT_ROOT/src/devices/mosquitto \
+    $$OPENRGB2MQTT_ROOT/OpenRGB \
+    $$OPENRGB2MQTT_ROOT/OpenRGB/i2c_smbus \
+    $$OPENRGB2MQTT_ROOT/OpenRGB/RGBController \
+    $$OPENRGB2MQTT_ROOT/OpenRGB/net_port \
+    $$OPENRGB2MQTT_ROOT/OpenRGB/dependencies/json \
+    $$OPENRGB2MQTT_ROOT/OpenRGB/hidapi_wrapper \
+    $$OPENRGB2MQTT_ROOT/OpenRGB/dependencies/hidapi-win/include \
+    $$OPENRGB2MQTT_ROOT/OpenRGB/SPDAccessor
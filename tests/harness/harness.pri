@@ -0,0 +1,20 @@
+# Included by tests and benchmarks: common settings plus the harness library
+include($$PWD/common.pri)
+
+CONFIG += console
+CONFIG -= app_bundle
+
+HARNESS_LIB_DIR = $$shadowed($$PWD)
+LIBS += -L$$HARNESS_LIB_DIR -lharness
+win32-msvc* {
+    PRE_TARGETDEPS += $$HARNESS_LIB_DIR/harness.lib
+} else {
+    PRE_TARGETDEPS += $$HARNESS_LIB_DIR/libharness.a
+}
+
+win32 {
+    LIBS += -L$$OPENRGB2MQTT_ROOT/mqtt_qt_setup/lib/ -lQt5Mqtt -lws2_32 -lole32
+}
+unix {
+    LIBS += -lQt5Mqtt
+}
@@ -0,0 +1,67 @@
+# Static library with the bridge sources (everything but the plugin UI) and the
+# in-process broker stand-in, linked by every test and benchmark
+include(common.pri)
+
+TEMPLATE = lib
+CONFIG += staticlib
+TARGET = harness
+DESTDIR = $$shadowed($$PWD)
+
+HEADERS += \
+    MQTTBrokerStandIn.h \
+    BenchmarkReport.h \
+    $$OPENRGB2MQTT_ROOT/src/utils/EncryptionHelper.h \
+    $$OPENRGB2MQTT_ROOT/src/utils/Trace.h \
+    $$OPENRGB2MQTT_ROOT/src/utils/PayloadHash.h \
+    $$OPENRGB2MQTT_ROOT/src/utils/LatencyHistogram.h \
+    $$OPENRGB2MQTT_ROOT/src/utils/StageMetrics.h \
+    $$OPENRGB2MQTT_ROOT/src/mqtt/MQTTHandler.h \
+    $$OPENRGB2MQTT_ROOT/src/mqtt/MQTTConnection.h \
+    $$OPENRGB2MQTT_ROOT/src/mqtt/TopicAliasTable.h \
+    $$OPENRGB2MQTT_ROOT/src/mqtt/SubscriptionRegistry.h \
+    $$OPENRGB2MQTT_ROOT/src/mqtt/TopicTable.h \
+    $$OPENRGB2MQTT_ROOT/src/mqtt/BridgeMetrics.h \
+    $$OPENRGB2MQTT_ROOT/src/mqtt/MessageRingBuffer.h \
+    $$OPENRGB2MQTT_ROOT/src/mqtt/TopicTrie.h \
+    $$OPENRGB2MQTT_ROOT/src/mqtt/OutboundQueue.h \
+    $$OPENRGB2MQTT_ROOT/src/mqtt/PublishOptions.h \
+    $$OPENRGB2MQTT_ROOT/src/mqtt/PublishRateLimiter.h \
+    $$OPENRGB2MQTT_ROOT/src/devices/DeviceManager.h \
+    $$OPENRGB2MQTT_ROOT/src/config/ConfigManager.h \
+    $$OPENRGB2MQTT_ROOT/src/devices/base/MQTTRGBDevice.h \
+    $$OPENRGB2MQTT_ROOT/src/devices/base/CustomRGBController.h \
+    $$OPENRGB2MQTT_ROOT/src/devices/base/RGBControllerTypes.h \
+    $$OPENRGB2MQTT_ROOT/src/devices/mosquitto/MosquittoDeviceManager.h \
+    $$OPENRGB2MQTT_ROOT/src/devices/mosquitto/MosquittoLightDevice.h \
+    $$OPENRGB2MQTT_ROOT/src/devices/mosquitto/DiscoveryCache.h \
+    $$OPENRGB2MQTT_ROOT/OpenRGB/RGBController/RGBController.h \
+    $$OPENRGB2MQTT_ROOT/OpenRGB/RGBController/RGBControllerKeyNames.h \
+    $$OPENRGB2MQTT_ROOT/OpenRGB/LogManager.h
+
+SOURCES += \
+    MQTTBrokerStandIn.cpp \
+    BenchmarkReport.cpp \
+    $$OPENRGB2MQTT_ROOT/src/utils/EncryptionHelper.cpp \
+    $$OPENRGB2MQTT_ROOT/src/utils/Trace.cpp \
+    $$OPENRGB2MQTT_ROOT/src/utils/LatencyHistogram.cpp \
+    $$OPENRGB2MQTT_ROOT/src/utils/StageMetrics.cpp \
+    $$OPENRGB2MQTT_ROOT/src/mqtt/MQTTHandler.cpp \
+    $$OPENRGB2MQTT_ROOT/src/mqtt/MQTTConnection.cpp \
+    $$OPENRGB2MQTT_ROOT/src/mqtt/TopicAliasTable.cpp \
+    $$OPENRGB2MQTT_ROOT/src/mqtt/SubscriptionRegistry.cpp \
+    $$OPENRGB2MQTT_ROOT/src/mqtt/TopicTable.cpp \
+    $$OPENRGB2MQTT_ROOT/src/mqtt/BridgeMetrics.cpp \
+    $$OPENRGB2MQTT_ROOT/src/mqtt/MessageRingBuffer.cpp \
+    $$OPENRGB2MQTT_ROOT/src/mqtt/TopicTrie.cpp \
+    $$OPENRGB2MQTT_ROOT/src/mqtt/OutboundQueue.cpp \
+    $$OPENRGB2MQTT_ROOT/src/mqtt/PublishRateLimiter.cpp \
+    $$OPENRGB2MQTT_ROOT/src/devices/DeviceManager.cpp \
+    $$OPENRGB2MQTT_ROOT/src/config/ConfigManager.cpp \
+    $$OPENRGB2MQTT_ROOT/src/devices/base/MQTTRGBDevice.cpp \
+    $$OPENRGB2MQTT_ROOT/src/devices/base/CustomRGBController.cpp \
+    $$OPENRGB2MQTT_ROOT/src/devices/mosquitto/MosquittoDeviceManager.cpp \
+    $$OPENRGB2MQTT_ROOT/src/devices/mosquitto/MosquittoLightDevice.cpp \
+    $$OPENRGB2MQTT_ROOT/src/devices/mosquitto/DiscoveryCache.cpp \
+    $$OPENRGB2MQTT_ROOT/OpenRGB/RGBController/RGBController.cpp \
+    $$OPENRGB2MQTT_ROOT/OpenRGB/RGBController/RGBControllerKeyNames.cpp \
+    $$OPENRGB2MQTT_ROOT/OpenRGB/LogManager.cpp
@@ -0,0 +1,12 @@
+# Tests and benchmarks for OpenRGB2MQTT, run against the in-process broker stand-in
+#
+#   qmake tests/tests.pro && make && make check && make benchmark
+TEMPLATE = subdirs
+
+SUBDIRS = \
+    harness \
+    auto \
+    benchmarks
+
+auto.depends = harness
+benchmarks.depends = harness